@@ -0,0 +1,314 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * Benchmark
+ * --------------
+ * Plays every game the same way that manageGame does, except that the responses come from the
+ * database instead of the user, and times the calls that the user would otherwise be waiting on.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include "Benchmark.h"
+#include "strlib.h"
+#include "error.h"
+#include "instrument.h"
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+using namespace std;
+
+/* Constants */
+static const int maxNumQuestions = 20;
+static const string SENTINEL = "EMPTY_SET";
+
+/**
+ * Function: elapsedNanos
+ * ----------------------
+ * Returns the number of nanoseconds since the start time.
+ */
+static int64_t elapsedNanos(chrono::steady_clock::time_point start) {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Function: nextRandom
+ * --------------------
+ * Returns the next number from a small xorshift generator, so that a seed always gives the same games on
+ * every platform.
+ */
+static uint64_t nextRandom(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+/**
+ * Function: peakMemoryKilobytes
+ * -----------------------------
+ * Returns the most memory the process has had resident at once, in kilobytes, or 0 where that is not known.
+ */
+static long peakMemoryKilobytes() {
+#ifndef _WIN32
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+/**
+ * Function: jsonString
+ * --------------------
+ * Returns the string as a quoted JSON string.
+ */
+static string jsonString(const string& str) {
+    string quoted = "\"";
+    for(char ch: str) {
+        if(ch == '"' || ch == '\\') quoted += '\\';
+        if(static_cast<unsigned char>(ch) < 0x20) quoted += ' ';
+        else quoted += ch;
+    }
+    return quoted + "\"";
+}
+
+/**
+ * Function: writeLatencies
+ * ------------------------
+ * Writes the number of calls and the 50th, 90th and 99th percentile and the longest of their times as a JSON object.
+ */
+static void writeLatencies(vector<int64_t> nanos, ostream& out) {
+    sort(nanos.begin(), nanos.end());
+    auto percentile = [&nanos](double fraction) {
+        return nanos.empty()? 0: nanos[size_t(fraction * (nanos.size() - 1) + 0.5)];
+    };
+    out << "{\"count\": " << nanos.size() << ", \"p50\": " << percentile(0.5) << ", \"p90\": " << percentile(0.9)
+        << ", \"p99\": " << percentile(0.99) << ", \"max\": " << (nanos.empty()? 0: nanos.back()) << "}";
+}
+
+/**
+ * Function: Benchmark::Benchmark
+ * ------------------------------
+ * Reads the database filename and the options from the description.  An option that is not understood
+ * throws an error.
+ */
+Benchmark::Benchmark(const string& description) :
+    strategy(INFORMATION_GAIN), noiseRate(0.0), sampleSize(0), seed(1), numThreads(1), openingDepth(-1),
+    minSupport(1), maxShare(1.0), budgetKilobytes(0), checkBatch(false),
+    loadSeconds(0.0), planSeconds(0.0), numGames(0), wins(0), wrongGuesses(0), questionsToWin(maxNumQuestions + 1, 0),
+    batchAgreed(0), batchSeconds(0.0) {
+    istringstream tokens(description);
+    if(!(tokens >> filename)) error("Benchmark needs a database to load");
+    string option;
+    while(tokens >> option)
+        parseOption(option);
+}
+
+/**
+ * Function: Benchmark::parseOption
+ * --------------------------------
+ * Sets one option from a key=value pair.  A value that is out of range for its option (such as fewer than one
+ * thread, or a maxshare that is not in (0, 1]) throws an error.
+ */
+void Benchmark::parseOption(const string& option) {
+    size_t equals = option.find('=');
+    if(equals == string::npos) error("Benchmark option " + option + " is not of the form key=value");
+    string key = option.substr(0, equals);
+    string value = option.substr(equals + 1);
+    if(key == "sample" && stringIsInteger(value)) sampleSize = stringToInteger(value);
+    else if(key == "noise" && stringIsReal(value)) noiseRate = stringToReal(value);
+    else if(key == "seed" && stringIsInteger(value)) seed = stringToInteger(value);
+    else if(key == "threads" && stringIsInteger(value)) numThreads = stringToInteger(value);
+    else if(key == "openings" && stringIsInteger(value)) openingDepth = stringToInteger(value);
+    else if(key == "minsupport" && stringIsInteger(value)) minSupport = stringToInteger(value);
+    else if(key == "maxshare" && stringIsReal(value)) maxShare = stringToReal(value);
+    else if(key == "budget" && stringIsInteger(value)) budgetKilobytes = stringToInteger(value);
+    else if(key == "batch" && (value == "0" || value == "1")) checkBatch = (value == "1");
+    else if(key == "strategy" && value == "split") strategy = EVEN_SPLIT;
+    else if(key == "strategy" && value == "gain") strategy = INFORMATION_GAIN;
+    else error("Benchmark option " + option + " is not understood");
+    if(sampleSize < 0 || numThreads < 1 || minSupport < 1 || maxShare <= 0.0 || maxShare > 1.0 ||
+            budgetKilobytes < 0 || noiseRate < 0.0 || noiseRate > 1.0 || openingDepth > DecisionTree::maxDepth)
+        error("Benchmark option " + option + " is out of range");
+}
+
+/**
+ * Function: Benchmark::run
+ * ------------------------
+ * Loads the database, plays the games and writes the report to the stream.  While the database loads, whatever
+ * it prints goes to cerr, so that the stream only ever holds the report.  Returns false if the database could
+ * not be opened.
+ */
+bool Benchmark::run(ostream& out) {
+    QuestionsDatabase database;
+    database.setNumThreads(numThreads);
+    database.setQuestionBounds(minSupport, maxShare);
+    database.setMemoryBudget(size_t(budgetKilobytes) * 1024);
+    streambuf* console = cout.rdbuf(cerr.rdbuf());
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bool loaded = endsWith(filename, ".tsv")? database.readFile(filename): database.readSnapshot(filename);
+    loadSeconds = elapsedNanos(start) / 1e9;
+    cout.rdbuf(console);
+    if(!loaded) return false;
+    if(openingDepth >= 0) {
+        start = chrono::steady_clock::now();
+        database.setOpeningTree(Session::planOpenings(database, openingDepth, strategy));
+        planSeconds = elapsedNanos(start) / 1e9;
+    }
+
+    Vector<int> answers;
+    for(int answer = 0; answer < database.numAnswers(); answer++)
+        answers += answer;
+    uint64_t random = 0x9E3779B97F4A7C15ull ^ seed;
+    if(sampleSize > 0 && sampleSize < answers.size()) {
+        for(int i = 0; i < sampleSize; i++)
+            swap(answers[i], answers[i + nextRandom(random) % (answers.size() - i)]);
+        while(answers.size() > sampleSize) answers.remove(answers.size() - 1);
+    }
+    for(int answer: answers) {
+        if(playGame(database, answer, random)) wins++;
+        numGames++;
+    }
+    if(checkBatch) compareBatch(database);
+    writeReport(database, out);
+    return true;
+}
+
+/**
+ * Function: Benchmark::playGame
+ * -----------------------------
+ * Plays one game with the answer as the hidden word, and returns whether the computer guessed it.  Each response
+ * is the truth from the database, flipped with the chance given by the noise rate.  Once the game is over, a new
+ * session is restored from its log, to time how long picking a game back up takes.  With batch=1, every turn up to
+ * the first wrong guess is kept for compareBatch, since a GameBatch cannot remove a wrong guess.
+ */
+bool Benchmark::playGame(const QuestionsDatabase& database, int answer, uint64_t& random) {
+    Session session(database, strategy);
+    string hidden(database.getAnswerNames().name(answer));
+    bool won = false;
+    bool rejected = false;
+    Vector<pair<string, bool> > responses;
+    for(int i = 1; i <= maxNumQuestions && !won; i++) {
+        string question;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bool guessing = session.getNextQuestion(question, i);
+        nextQuestionNanos.push_back(elapsedNanos(start));
+        if(checkBatch && !rejected) batchTurns.push_back(batchTurn{responses, question, guessing});
+        if(guessing) {
+            if(question == hidden) {
+                questionsToWin[i]++;
+                won = true;
+                continue;
+            }
+            wrongGuesses++;
+            rejected = true;
+            session.removeIncorrectGuess(question);
+        } else {
+            if(question == SENTINEL) break;
+            bool response = database.fits(answer, database.getQuestionNames().find(question));
+            if(double(nextRandom(random) >> 11) / double(1ull << 53) < noiseRate) response = !response;
+            start = chrono::steady_clock::now();
+            session.updateDatabase(response, question, i);
+            updateNanos.push_back(elapsedNanos(start));
+            responses.add(make_pair(question, response));
+        }
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Session restored(database, session.getLog());
+    restoreNanos.push_back(elapsedNanos(start));
+    return won;
+}
+
+/**
+ * Function: Benchmark::compareBatch
+ * ---------------------------------
+ * Scores every kept turn through one GameBatch and counts the turns on which it would do what the session did:
+ * ask the same question, guess the same answer, or find no candidates left.
+ */
+void Benchmark::compareBatch(const QuestionsDatabase& database) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    GameBatch batch(database, strategy);
+    for(const batchTurn& turn: batchTurns)
+        batch.addGame(turn.responses);
+    Vector<GameScore> scores = batch.score();
+    batchSeconds = elapsedNanos(start) / 1e9;
+    for(int game = 0; game < scores.size(); game++) {
+        const batchTurn& turn = batchTurns[game];
+        if(turn.question == SENTINEL) batchAgreed += (scores[game].candidates == 0);
+        else if(turn.guessing) batchAgreed += (scores[game].bestGuess == turn.question);
+        else batchAgreed += (scores[game].nextQuestion == turn.question);
+    }
+}
+
+/**
+ * Function: Benchmark::writeReport
+ * --------------------------------
+ * Writes everything that was measured as one JSON object.  Entry i of questions_to_win is the number of games
+ * that were won on question i.  column_cache is all zeros unless the database was given a memory budget that
+ * left some of its columns on disk.  The instrumentation counters (empty unless the program was built with them) are
+ * included as well, covering the load and every game.
+ */
+void Benchmark::writeReport(const QuestionsDatabase& database, ostream& out) {
+    int totalQuestions = 0;
+    for(int i = 1; i <= maxNumQuestions; i++)
+        totalQuestions += i * questionsToWin[i];
+    out << "{" << endl;
+    out << "  \"database\": " << jsonString(filename) << "," << endl;
+    out << "  \"answers\": " << database.numAnswers() << "," << endl;
+    out << "  \"questions\": " << database.numQuestions() << "," << endl;
+    out << "  \"strategy\": \"" << (strategy == EVEN_SPLIT? "split": "gain") << "\"," << endl;
+    out << "  \"noise\": " << noiseRate << "," << endl;
+    out << "  \"seed\": " << seed << "," << endl;
+    out << "  \"threads\": " << numThreads << "," << endl;
+    out << "  \"load_seconds\": " << loadSeconds << "," << endl;
+    out << "  \"opening_nodes\": " << database.getOpeningTree().numNodes() << "," << endl;
+    out << "  \"plan_seconds\": " << planSeconds << "," << endl;
+    out << "  \"matrix_bytes\": " << database.matrixMemoryUsage() << "," << endl;
+    out << "  \"question_list_bytes\": " << database.questionListMemoryUsage() << "," << endl;
+    out << "  \"peak_rss_kb\": " << peakMemoryKilobytes() << "," << endl;
+    ColumnCache::Stats cache = database.columnCacheStats();
+    uint64_t lookups = cache.hits + cache.misses;
+    out << "  \"column_cache\": {\"budget_kb\": " << budgetKilobytes
+        << ", \"offloaded_questions\": " << database.getOffloadedQuestions().count()
+        << ", \"hits\": " << cache.hits << ", \"misses\": " << cache.misses
+        << ", \"hit_rate\": " << (lookups == 0? 0.0: double(cache.hits) / lookups)
+        << ", \"bytes_read\": " << cache.bytesRead << ", \"io_seconds\": " << cache.ioSeconds
+        << ", \"cached_bytes\": " << cache.cachedBytes << ", \"capacity\": " << cache.capacity << "}," << endl;
+    out << "  \"games\": " << numGames << "," << endl;
+    out << "  \"wins\": " << wins << "," << endl;
+    out << "  \"win_rate\": " << (numGames == 0? 0.0: double(wins) / numGames) << "," << endl;
+    out << "  \"give_ups\": " << numGames - wins << "," << endl;
+    out << "  \"wrong_guesses\": " << wrongGuesses << "," << endl;
+    out << "  \"mean_questions_to_win\": " << (wins == 0? 0.0: double(totalQuestions) / wins) << "," << endl;
+    if(checkBatch) {
+        out << "  \"batch\": {\"turns\": " << batchTurns.size() << ", \"agreed\": " << batchAgreed
+            << ", \"seconds\": " << batchSeconds << "}," << endl;
+    }
+    out << "  \"questions_to_win\": [";
+    for(int i = 0; i <= maxNumQuestions; i++)
+        out << (i == 0? "": ", ") << questionsToWin[i];
+    out << "]," << endl;
+    out << "  \"latency_ns\": {" << endl;
+    out << "    \"get_next_question\": ";
+    writeLatencies(nextQuestionNanos, out);
+    out << "," << endl << "    \"update_database\": ";
+    writeLatencies(updateNanos, out);
+    out << "," << endl << "    \"restore_session\": ";
+    writeLatencies(restoreNanos, out);
+    out << endl << "  }," << endl;
+    out << "  \"counters\": {";
+    bool first = true;
+    Instrument::forEach([&out, &first](const string& name, uint64_t count, uint64_t sum) {
+        out << (first? "": ",") << endl << "    " << jsonString(name) << ": {\"count\": " << count
+            << ", \"sum\": " << sum << "}";
+        first = false;
+    });
+    out << endl << "  }" << endl << "}" << endl;
+}
@@ -0,0 +1,88 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * Benchmark
+ * --------------
+ * The benchmark plays the game against itself without anyone at the keyboard, so that changes to the
+ * question engine can be measured.  It loads a database, then plays every answer (or a random sample
+ * of them) as the hidden word, with an oracle that answers each question from the database itself and
+ * can be told to give the wrong response at a set rate.  It reports how long the database took to load,
+ * how much memory the incidence matrix and the answers' lists of questions take, the peak memory use, how
+ * the column cache did, how many games were won, how many questions each win took, how long each call
+ * to getNextQuestion and updateDatabase took, and how long restoring each finished game from its log
+ * took, all as a single JSON object.
+ *
+ * The benchmark is described by a line such as
+ *
+ *     yagoTypes.tsv sample=100 noise=0.05 strategy=split seed=7 threads=4 openings=10 minsupport=2 maxshare=0.9 budget=4096
+ *
+ * which names the database (a .tsv file or a snapshot) followed by any of the options.  By default every
+ * answer is played once, with no noise, the information gain strategy, seed 1, one thread, and whatever
+ * opening tree the database came with; openings=N plans a new tree of depth N (0 removes it) first.
+ * minsupport and maxshare set the question bounds used when a .tsv file is read, and budget=N keeps the
+ * database's columns within N kilobytes, leaving the rest on disk (see QuestionsDatabase::setMemoryBudget).
+ * batch=1 also scores every turn of every game, up to its first wrong guess, through a GameBatch, and
+ * reports how often the batch picked the same question or guess as the session did, and how long it took.
+ */
+
+#ifndef _benchmark_
+#define _benchmark_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "vector.h"
+#include "Session.h"
+#include "GameBatch.h"
+#include "QuestionsDatabase.h"
+
+using namespace std;
+
+class Benchmark {
+public:
+
+    Benchmark(const string& description);
+
+    bool run(ostream& out);
+
+private:
+    string filename;
+    QuestionStrategy strategy;
+    double noiseRate; // the chance that the oracle gives the wrong response
+    int sampleSize; // the number of answers to play, or 0 to play all of them
+    unsigned seed;
+    int numThreads;
+    int openingDepth; // the depth of the opening tree to plan, or -1 to keep the database's own
+    int minSupport;
+    double maxShare;
+    int budgetKilobytes; // the memory budget for the database's columns, or 0 for none
+    bool checkBatch; // whether to score the same turns through a GameBatch
+
+    double loadSeconds;
+    double planSeconds;
+    int numGames;
+    int wins;
+    int wrongGuesses;
+    Vector<int> questionsToWin; // number of questions to the number of games won with that many
+    vector<int64_t> nextQuestionNanos; // how long each call to getNextQuestion took
+    vector<int64_t> updateNanos; // how long each call to updateDatabase took
+    vector<int64_t> restoreNanos; // how long restoring each game from its log took
+
+    /* One turn a session played, to score through a GameBatch. */
+    struct batchTurn {
+        Vector<pair<string, bool> > responses; // every response before the turn
+        string question; // what the session asked or guessed, or SENTINEL if it had no candidates
+        bool guessing;
+    };
+    vector<batchTurn> batchTurns;
+    int batchAgreed; // the turns on which the batch would do what the session did
+    double batchSeconds;
+
+    void parseOption(const string& option);
+    bool playGame(const QuestionsDatabase& database, int answer, uint64_t& random);
+    void compareBatch(const QuestionsDatabase& database);
+    void writeReport(const QuestionsDatabase& database, ostream& out);
+};
+
+#endif
@@ -0,0 +1,252 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * GameBatch
+ * --------------
+ * Replays every game's responses into its sets of candidates as the game is added, and scores all
+ * of the games together a block at a time.  See GameBatch.h for what the scores mean.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "GameBatch.h"
+#include "error.h"
+#include "instrument.h"
+using namespace std;
+
+/* Constants */
+static const double thresholdValue = 0.75;
+static const double defaultNoiseRate = 0.05;
+static const int defaultMaxMismatches = 2;
+static const double offloadedPenalty = 0.02;
+static const int weightBits = 30;
+static const int blockSize = 32;
+static const int minParallelGames = 2 * blockSize;
+
+/**
+ * Function: GameBatch::GameBatch
+ * ------------------------------
+ * Creates an empty batch that scores games the way a session with the given strategy and the default noise
+ * rate and number of allowed mismatches would play them.
+ */
+GameBatch::GameBatch(const QuestionsDatabase& database, QuestionStrategy strategy) :
+    GameBatch(database, strategy, defaultNoiseRate, defaultMaxMismatches) {
+}
+
+/**
+ * Function: GameBatch::GameBatch
+ * ------------------------------
+ * Creates an empty batch that scores games the way a session with the given rules would play them.  The
+ * database must stay around (and unchanged) for as long as the batch is in use.
+ */
+GameBatch::GameBatch(const QuestionsDatabase& database, QuestionStrategy strategy, double noiseRate, int maxMismatches) :
+    database(&database),
+    strategy(strategy),
+    maxMismatches(maxMismatches) {
+    if(noiseRate <= 0.0 || noiseRate >= 0.5) error("Noise rate must be between 0 and 0.5");
+    if(maxMismatches < 0) error("Maximum number of mismatches cannot be negative");
+    for(int mismatches = 0; mismatches <= maxMismatches; mismatches++) {
+        double units = round(ldexp(pow(noiseRate / (1.0 - noiseRate), mismatches), weightBits));
+        mismatchWeights.add(ldexp(max(units, 1.0), -weightBits));
+    }
+}
+
+/**
+ * Function: GameBatch::addGame
+ * ----------------------------
+ * Adds a game that asked the given questions and got the given responses, in order, and returns its index in
+ * the scores.  Every answer starts out as a candidate with no mismatches, and each response is then applied the
+ * same way Session::updateDatabase applies it.  Throws an error if a question is not in the database.
+ */
+int GameBatch::addGame(const Vector<pair<string, bool> >& responses) {
+    gameInfo game;
+    game.asked = BitVector(database->numQuestions());
+    std::vector<BitVector> levels(1, BitVector(database->numAnswers()));
+    levels[0].setAll();
+    for(int i = 0; i < responses.size(); i++) {
+        int question = database->getQuestionNames().find(responses[i].first);
+        if(question == -1) error("Database does not contain question");
+        game.asked.set(question);
+        addResponse(levels, question, responses[i].second, i + 1);
+    }
+    packGame(levels, game);
+    game.guess = bestGuess(levels);
+    games.push_back(game);
+    return games.size() - 1;
+}
+
+/**
+ * Function: GameBatch::size
+ * -------------------------
+ * Returns the number of games in the batch.
+ */
+int GameBatch::size() const {
+    return games.size();
+}
+
+/**
+ * Function: GameBatch::addResponse
+ * --------------------------------
+ * Applies the response to the question, which was response number numResponses of the game.  The candidates
+ * that the response does not match move up one level, starting from the top so that none of them moves twice,
+ * and the ones that would go past the top level are dropped.  With INFORMATION_GAIN the top level is the number
+ * of allowed mismatches.  With EVEN_SPLIT a candidate is dropped once fewer than 75% of the responses match it,
+ * so the top level is the most mismatches that still leaves 75% of the responses so far matching.
+ */
+void GameBatch::addResponse(std::vector<BitVector>& levels, int question, bool response, int numResponses) const {
+    int numLevels = maxMismatches + 1;
+    if(strategy == EVEN_SPLIT) numLevels = int(numResponses * (1.0 - thresholdValue)) + 1;
+    while(int(levels.size()) < numLevels)
+        levels.push_back(BitVector(database->numAnswers()));
+    BitVector column(database->numAnswers());
+    database->getQuestionColumn(question)->forEachSet([&column](int answer) { column.set(answer); });
+    for(int level = numLevels - 1; level >= 0; level--) {
+        BitVector mismatched = levels[level];
+        if(response) {
+            mismatched.subtract(column);
+            levels[level].intersect(column);
+        } else {
+            mismatched.intersect(column);
+            levels[level].subtract(column);
+        }
+        if(level + 1 < numLevels) levels[level + 1].unite(mismatched);
+    }
+}
+
+/**
+ * Function: GameBatch::packGame
+ * -----------------------------
+ * Keeps what scoring needs from the game's levels.  Empty levels are left out, and of the rest only the words in
+ * which some level has a candidate are kept, so a game that has narrowed down to a few candidates only costs a
+ * few words per question however many answers there are.
+ */
+void GameBatch::packGame(const std::vector<BitVector>& levels, gameInfo& game) const {
+    game.candidates = 0;
+    game.totalWeight = 0.0;
+    std::vector<int> kept;
+    for(int level = 0; level < int(levels.size()); level++) {
+        int count = levels[level].count();
+        if(count == 0) continue;
+        kept.push_back(level);
+        game.weights.push_back(levelWeight(level));
+        game.candidates += count;
+        game.totalWeight += count * levelWeight(level);
+    }
+    for(int word = 0; word < levels[0].numWords(); word++) {
+        for(int level: kept) {
+            if(levels[level].data()[word] != 0) {
+                game.words.push_back(word);
+                break;
+            }
+        }
+    }
+    for(int level: kept) {
+        for(int word: game.words)
+            game.bits.push_back(levels[level].data()[word]);
+    }
+}
+
+/**
+ * Function: GameBatch::score
+ * --------------------------
+ * Scores every game in the batch, in the order they were added.  When the database has search workers and
+ * there are enough games, the games are split into ranges that are scored in parallel.
+ */
+Vector<GameScore> GameBatch::score() const {
+    INSTRUMENT_TIMER("batch_score");
+    INSTRUMENT_COUNT("batch_games", games.size());
+    Vector<GameScore> scores(games.size(), GameScore{0, "", ""});
+    auto scoreRange = [&](int /*chunk*/, int begin, int end) {
+        for(int block = begin; block < end; block += blockSize)
+            scoreBlock(block, min(block + blockSize, end), scores);
+    };
+    ThreadPool* searchPool = database->getSearchPool();
+    if(searchPool == NULL || int(games.size()) < minParallelGames) scoreRange(0, 0, games.size());
+    else searchPool->parallelFor(0, games.size(), scoreRange);
+    return scores;
+}
+
+/**
+ * Function: GameBatch::scoreBlock
+ * -------------------------------
+ * Scores the games in [begin, end).  The weight of a game's candidates that fit a question is the number of them
+ * on each level that fit it, times that level's weight.  For every question, the column is unpacked once into a
+ * word of bits for every 64 answers, which is counted against the words of each game in the block before the
+ * column is cleared again and the next question is unpacked.  Each game keeps the question that most evenly
+ * splits its weight so far, with the same small penalty for a column that is on disk.  As in
+ * Session::selectBestQuestion, a question only replaces the best when it is strictly better, so ties go to the
+ * lowest index.  The weights are rounded the same way as a session's, so the sums are exact and match the ones a
+ * session keeps up to date as it goes.
+ */
+void GameBatch::scoreBlock(int begin, int end, Vector<GameScore>& scores) const {
+    int numGames = end - begin;
+    std::vector<double> costs(numGames, HUGE_VAL);
+    std::vector<int> bests(numGames, -1);
+    std::vector<uint64_t> columnWords(BitVector::wordsFor(database->numAnswers()), 0);
+    std::vector<int> touched;
+    const BitVector& offloaded = database->getOffloadedQuestions();
+    for(int question = 0; question < database->numQuestions(); question++) {
+        double penalty = offloadedPenalty * offloaded.test(question);
+        std::shared_ptr<const HybridColumn> column = database->getQuestionColumn(question);
+        column->forEachWord([&](int word, uint64_t bits) {
+            columnWords[word] = bits;
+            touched.push_back(word);
+        });
+        for(int game = 0; game < numGames; game++) {
+            const gameInfo& info = games[begin + game];
+            if(info.candidates == 0 || info.asked.test(question)) continue;
+            int numWords = info.words.size();
+            double counter = 0.0;
+            for(int level = 0; level < int(info.weights.size()); level++) {
+                const uint64_t* bits = info.bits.data() + level * numWords;
+                int count = 0;
+                for(int word = 0; word < numWords; word++)
+                    count += __builtin_popcountll(columnWords[info.words[word]] & bits[word]);
+                counter += count * info.weights[level];
+            }
+            double distance = abs(0.5 - (counter / info.totalWeight));
+            if(distance < 0.5 && distance + penalty < costs[game]) {
+                costs[game] = distance + penalty;
+                bests[game] = question;
+            }
+        }
+        for(int word: touched)
+            columnWords[word] = 0;
+        touched.clear();
+    }
+    for(int game = 0; game < numGames; game++) {
+        const gameInfo& info = games[begin + game];
+        GameScore& score = scores[begin + game];
+        score.candidates = info.candidates;
+        if(info.guess != -1) score.bestGuess = string(database->getAnswerNames().name(info.guess));
+        if(bests[game] != -1) score.nextQuestion = string(database->getQuestionNames().name(bests[game]));
+    }
+}
+
+/**
+ * Function: GameBatch::levelWeight
+ * --------------------------------
+ * Returns the weight of a candidate with the given number of mismatches.  With EVEN_SPLIT every candidate that
+ * is left counts the same.
+ */
+double GameBatch::levelWeight(int mismatches) const {
+    return (strategy == EVEN_SPLIT)? 1.0: mismatchWeights[mismatches];
+}
+
+/**
+ * Function: GameBatch::bestGuess
+ * ------------------------------
+ * Returns the candidate a session would guess, or -1 if there are none: the one with the fewest mismatches,
+ * breaking ties in favor of the alphabetically first answer, just like Session::bestGuess.
+ */
+int GameBatch::bestGuess(const std::vector<BitVector>& levels) const {
+    const Vector<int>& ranks = database->getAnswerRanks();
+    for(const BitVector& level: levels) {
+        int best = -1;
+        level.forEachSet([&](int answer) {
+            if(best == -1 || ranks[answer] < ranks[best]) best = answer;
+        });
+        if(best != -1) return best;
+    }
+    return -1;
+}
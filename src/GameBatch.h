@@ -0,0 +1,76 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * GameBatch
+ * --------------
+ * A game batch scores many games that are already under way against the same database at once,
+ * which is much faster than replaying each of them through its own Session.  Every game is given as
+ * the questions it has asked and the responses it got, in order, just like a session's record of
+ * them.  For each game the batch works out how many candidates are left, which one a session would
+ * guess, and which question a session would ask next, with the same rules (and the same strategy,
+ * noise rate and number of allowed mismatches) as Session.  The history only holds questions, so a
+ * wrong guess that was removed along the way is not taken into account.
+ *
+ * Instead of a number per candidate, a game is replayed into one set of answers per number of
+ * mismatches (the answers with no mismatches, the ones with one, and so on), so every response is a
+ * handful of bitwise operations on those sets.  The game then only keeps the words of those sets
+ * that hold a candidate, which is all that scoring needs.  Scoring goes through the question columns
+ * once for each block of games: while a column is loaded, it is counted against every game in the
+ * block, so each column is read from memory once per block instead of once per game.
+ */
+
+#ifndef _gamebatch_
+#define _gamebatch_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "vector.h"
+#include "bitvector.h"
+#include "Session.h"
+#include "QuestionsDatabase.h"
+
+using namespace std;
+
+/* What a session would do next in one game of the batch. */
+struct GameScore {
+    int candidates; // the number of answers that are still candidates
+    string bestGuess; // the answer a session would guess, or empty if there are no candidates
+    string nextQuestion; // the question a session would ask, or empty if no question splits the candidates
+};
+
+class GameBatch {
+public:
+
+    GameBatch(const QuestionsDatabase& database, QuestionStrategy strategy = INFORMATION_GAIN);
+    GameBatch(const QuestionsDatabase& database, QuestionStrategy strategy, double noiseRate, int maxMismatches);
+
+    int addGame(const Vector<pair<string, bool> >& responses);
+    int size() const;
+    Vector<GameScore> score() const;
+
+private:
+    struct gameInfo {
+        int candidates; // the number of candidates left
+        double totalWeight; // the total weight of the candidates
+        int guess; // the answer a session would guess, or -1 if there are no candidates
+        BitVector asked; // bit per question that the game has already asked
+        std::vector<double> weights; // the weight of each level that has a candidate
+        std::vector<int> words; // the words in which some level has a candidate, in increasing order
+        std::vector<uint64_t> bits; // each of those levels' bits in those words, one level after another
+    };
+
+    const QuestionsDatabase* database; // shared, never changed by the batch
+    QuestionStrategy strategy;
+    int maxMismatches; // candidates with more mismatches than this are dropped (INFORMATION_GAIN only)
+    Vector<double> mismatchWeights; // number of mismatches to the weight of a candidate with that many
+    std::vector<gameInfo> games;
+    void addResponse(std::vector<BitVector>& levels, int question, bool response, int numResponses) const;
+    void packGame(const std::vector<BitVector>& levels, gameInfo& game) const;
+    void scoreBlock(int begin, int end, Vector<GameScore>& scores) const;
+    double levelWeight(int mismatches) const;
+    int bestGuess(const std::vector<BitVector>& levels) const;
+};
+
+#endif
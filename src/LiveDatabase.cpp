@@ -0,0 +1,105 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * LiveDatabase
+ * --------------
+ * Publishes new epochs of a database by appending staged answers and questions to a copy of the
+ * current one.  Publishing only holds the lock on the current epoch for as long as it takes to swap
+ * a pointer, so starting a session never waits for the appends to finish.
+ */
+
+#include "LiveDatabase.h"
+#include "TsvLoader.h"
+#include "instrument.h"
+using namespace std;
+
+/**
+ * Function: LiveDatabase::LiveDatabase
+ * ------------------------------------
+ * Starts with the loaded database as the current epoch.  The database must not be changed through any other
+ * pointer from now on.
+ */
+LiveDatabase::LiveDatabase(shared_ptr<QuestionsDatabase> loaded) : published(loaded) {
+}
+
+/**
+ * Function: LiveDatabase::current
+ * -------------------------------
+ * Returns the current epoch.  A session should be started from the pointer (rather than a reference) so that
+ * the epoch stays alive for as long as the session is playing against it.
+ */
+shared_ptr<const QuestionsDatabase> LiveDatabase::current() const {
+    lock_guard<mutex> lock(currentLock);
+    return published;
+}
+
+/**
+ * Function: LiveDatabase::stageAnswer
+ * -----------------------------------
+ * Stages a new answer that fits the given questions, such as one the user taught the program after it gave up.
+ * Nothing is visible to new sessions until the next publish.
+ */
+void LiveDatabase::stageAnswer(const string& answer, const Vector<string>& questions) {
+    lock_guard<mutex> lock(writerLock);
+    staged.push_back(make_pair(answer, string()));
+    for(const string& question: questions)
+        staged.push_back(make_pair(answer, question));
+}
+
+/**
+ * Function: LiveDatabase::stageEdge
+ * ---------------------------------
+ * Stages that the answer fits the question.  Either of them may be new.
+ */
+void LiveDatabase::stageEdge(const string& answer, const string& question) {
+    lock_guard<mutex> lock(writerLock);
+    staged.push_back(make_pair(answer, question));
+}
+
+/**
+ * Function: LiveDatabase::publish
+ * -------------------------------
+ * Appends everything staged to a copy of the current epoch and makes the copy current, all at once, so a new
+ * session sees either none of the staged pairs or all of them.  Returns the number of the current epoch, which
+ * does not change if nothing was staged.  The copy shares the columns and the answers' lists of questions, but
+ * copies the names, the answers' sorted order and ranks and the questions' support, so each publish takes time
+ * in proportion to the number of answers and questions, however few pairs were staged.
+ */
+int LiveDatabase::publish() {
+    INSTRUMENT_TIMER("publish_epoch");
+    lock_guard<mutex> lock(writerLock);
+    shared_ptr<const QuestionsDatabase> last = current();
+    if(staged.empty()) return last->getEpoch();
+    shared_ptr<QuestionsDatabase> next = make_shared<QuestionsDatabase>(*last);
+    next->startNextEpoch();
+    for(const pair<string, string>& edge: staged) {
+        if(edge.second.empty()) next->appendAnswer(edge.first);
+        else next->appendEdge(edge.first, edge.second);
+    }
+    INSTRUMENT_COUNT("published_edges", staged.size());
+    staged.clear();
+    lock_guard<mutex> swap(currentLock);
+    published = next;
+    return next->getEpoch();
+}
+
+/**
+ * Function: LiveDatabase::tail
+ * ----------------------------
+ * Reads the lines that were appended to the TSV file since the last time it was tailed (or the whole file, the
+ * first time), and publishes them as a new epoch.  A last line that is still being written is left for the next
+ * time.  Returns the number of answer/question pairs read, or -1 if the file could not be opened.
+ */
+int LiveDatabase::tail(const string& filename) {
+    lock_guard<mutex> lock(tailLock);
+    TsvLoader loader;
+    if(!loader.open(filename, tailOffsets.get(filename), true)) return -1;
+    loader.parse();
+    const vector<string_view>& answers = loader.getAnswers();
+    const vector<string_view>& categories = loader.getCategories();
+    for(const pair<int, int>& edge: loader.getEdges())
+        stageEdge(string(answers[edge.first]), string(categories[edge.second]));
+    tailOffsets[filename] = loader.getEndOffset();
+    publish();
+    return loader.getEdges().size();
+}
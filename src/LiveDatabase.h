@@ -0,0 +1,51 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * LiveDatabase
+ * --------------
+ * A live database lets new answers and questions be added while games are being played, without
+ * reloading anything and without pausing any session.  It holds the current epoch: a loaded
+ * QuestionsDatabase that never changes.  New answers and answer/question pairs are staged, and
+ * publishing them copies the current epoch (which shares every column and list of questions with
+ * it, but copies the names; see publish), appends the staged pairs to the copy, and makes the copy
+ * the current epoch.  Sessions that are already playing keep the epoch they started with, so
+ * everything they see stays consistent, and each epoch is freed once the last session playing
+ * against it ends.  Pairs can also be read from an append-only TSV file, a piece at a time, as it
+ * grows.
+ */
+
+#ifndef _livedatabase_
+#define _livedatabase_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "map.h"
+#include "vector.h"
+#include "QuestionsDatabase.h"
+
+using namespace std;
+
+class LiveDatabase {
+public:
+
+    LiveDatabase(shared_ptr<QuestionsDatabase> loaded);
+
+    shared_ptr<const QuestionsDatabase> current() const;
+    void stageAnswer(const string& answer, const Vector<string>& questions);
+    void stageEdge(const string& answer, const string& question);
+    int publish();
+    int tail(const string& filename);
+
+private:
+    mutable mutex currentLock; // only held while the current epoch is read or replaced
+    mutex writerLock; // held while staging and publishing, so that appends never interleave
+    mutex tailLock; // held while a file is tailed, so that no piece of it is read twice
+    shared_ptr<const QuestionsDatabase> published;
+    vector<pair<string, string> > staged; // answer/question pairs; an empty question stages just the answer
+    Map<string, size_t> tailOffsets; // file to how far it has been read
+};
+
+#endif
@@ -10,6 +10,7 @@
  * many answers and assoicated categories/questions, and will determine what the answer is the user is thinking of.
  */
 
+#include <cstdlib>
 #include <iostream>
 #include "fstream"
 #include "console.h"
@@ -17,6 +18,12 @@
 #include <string>
 #include "strlib.h"
 #include "QuestionsDatabase.h"
+#include "LiveDatabase.h"
+#include "Session.h"
+#include "TurnPipeline.h"
+#include "SessionServer.h"
+#include "Benchmark.h"
+#include "instrument.h"
 
 using namespace std;
 
@@ -24,35 +31,60 @@ using namespace std;
 static const string sampleFile = "yagoTypes.tsv";
 static const int maxNumQuestions = 20;
 static const string SENTINEL = "EMPTY_SET";
+static const int numSearchThreads = 4;
+static const int openingDepth = 10;
+static const int maxSuggestions = 5;
+static const char* serverVariable = "TWENTY_QUESTIONS_SERVER";
+static const char* benchmarkVariable = "TWENTY_QUESTIONS_BENCHMARK";
+static const char* budgetVariable = "TWENTY_QUESTIONS_BUDGET_MB";
+
+/**
+ * Function: setMemoryBudget
+ * -------------------------
+ * Gives the database the memory budget in the budget variable, in megabytes, if it is set, so that a database
+ * too big for the machine keeps the rest of its columns on disk.
+ */
+void setMemoryBudget(QuestionsDatabase& database) {
+    const char* budget = getenv(budgetVariable);
+    if(budget == NULL) return;
+    if(!stringIsInteger(budget) || stringToInteger(budget) <= 0)
+        error(string(budgetVariable) + " must be a positive number of megabytes");
+    database.setMemoryBudget(size_t(stringToInteger(budget)) << 20);
+}
 
 /**
  * Function: loadDatabase
  * ----------------------
- * This prompts the user whether or not they want to use the sample database, or try to read in a file of their
- * own.  If they want to read in a file of their own, the program will alert the user of the format
- * that the text file has to be in, and that the questions have to be good enough so that the
- * computer can deduce what the user is thinking of.
+ * This prompts the user whether or not they want to use the sample database, open a snapshot that was saved
+ * earlier, or try to read in a file of their own.  If they want to read in a file of their own, the program will
+ * alert the user of the format that the text file has to be in, and that the questions have to be good enough so
+ * that the computer can deduce what the user is thinking of.  Since a big file takes a while to read, they can
+ * then save it as a snapshot, which loads much faster the next time.  The opening moves of every game are planned
+ * before the snapshot is saved, so games played from the snapshot do not have to search for their first questions.
  */
 void loadDatabase(QuestionsDatabase& database) {
-    ifstream input;
     cout << "You have the option to load in your own 20 questions database, " << endl;
     cout << "or you can use the sample database that is preloaded." << endl;
     if(getYesOrNo("Would you like to use the sample database?")) {
-        input.open(sampleFile);
-        database.readFile(input);
+        if(!database.readFile(sampleFile)) error("Could not open the sample database.");
         if(getYesOrNo("Would you like to see the famous people, places or things that you can choose from?"))
-            database.showAnswerKey();
+            database.showAnswerKey(
+                getLine("Enter the start of a name to only see those, or hit enter to see them all: "));
+    } else if(getYesOrNo("Would you like to open a snapshot that you saved earlier?")) {
+        if(!database.readSnapshot(getLine("Enter snapshot filename: "))) error("That was an invalid filename.");
     } else {
         cout << "If you want to read in your own file.  It must be in the format" << endl;
         cout << "<answer>  <question/category>" << endl;
         cout << "Also, you may want to keep in mind that if your dataset is not thorough" << endl;
         cout << "where there are not ample enough questions that evenly divide the dataset," << endl;
         cout << "then it will be tough for me to figure out what you are thinking of!" << endl;
-        input.open(getLine("Enter filename: "));
-        if(input.fail()) error("That was an invalid filename.");
-        database.readFile(input);
+        if(!database.readFile(getLine("Enter filename: "))) error("That was an invalid filename.");
+        if(getYesOrNo("Would you like to save this database as a snapshot so it loads faster next time?")) {
+            database.setOpeningTree(Session::planOpenings(database, openingDepth));
+            if(!database.writeSnapshot(getLine("Enter snapshot filename: ")))
+                cout << "Sorry, I could not write that snapshot." << endl;
+        }
     }
-    input.close();
 }
 
 /** Prints the introduction as well as the rules for the game */
@@ -73,58 +105,127 @@ void printRules() {
  * ----------------
  * If the computer does not know what the user is thinking of (either because of incorrect
  * responses or because of a subpar dataset), it will ask the user for the word that
- * they were thinking of.  If the word is new, it will alert the user of that, otherwise it
- * will display all of the questions that the user answered incorrectly.
+ * they were thinking of.  If the database does not know the word, it offers the answers the user may
+ * have meant instead (in case of a typo).  If the word is still new, it will alert the user of that and
+ * offer to learn it, as an answer that fits every category the user said yes to, from the next game on.
+ * Otherwise it will display all of the questions that the user answered incorrectly.
  */
-void giveUp(QuestionsDatabase& database) {
+void giveUp(LiveDatabase& live, const QuestionsDatabase& database, Session& session) {
     string response = getLine("Hmm I am stumped. What was you word?");
-    if(database.contains(response)) database.findDifference(response);
-    else cout << "It seems as though that word was not in the database." << endl;
+    if(!database.contains(response)) {
+        for(string suggestion: database.suggestAnswers(response, maxSuggestions)) {
+            if(getYesOrNo("Did you mean " + suggestion + "?")) {
+                response = suggestion;
+                break;
+            }
+        }
+    }
+    if(database.contains(response)) {
+        session.findDifference(response);
+    } else {
+        cout << "It seems as though that word was not in the database." << endl;
+        if(getYesOrNo("Would you like me to learn it for next time?")) {
+            live.stageAnswer(response, session.getYesQuestions());
+            live.publish();
+        }
+    }
 }
 
 /**
  * Function: manageGame
  * --------------------
- * Initializes the database for the game, as well as controls the questions asked.  It will
- * call to the database to find the next question, and if that question is a guess,
+ * Loads the database once, then starts a new session on the current epoch for every game and controls the
+ * questions asked.  It will
+ * call to the session to find the next question, and if that question is a guess,
  * it will guess the word that the user was thinking of.  If thew question is the
  * sentinel value, it will call the giveUp method and will break the loop.  Otherwise,
- * it will ask the question, and will update the database with the response that the computer
- * receives. After 20 questions have been asked, it will ask if they want to quit.
+ * it will ask the question, and will update the session with the response that the computer
+ * receives. After 20 questions have been asked, it will ask if they want to quit.  The session is played through a
+ * TurnPipeline, so the next question is worked out while the user thinks about the current one; the pipeline is
+ * cancelled before the session is used directly.  When the program is built with instrumentation, the counters so
+ * far are written to cerr at the end of every game.
  */
 void manageGame() {
+    shared_ptr<QuestionsDatabase> loaded = make_shared<QuestionsDatabase>();
+    loaded->setNumThreads(numSearchThreads);
+    setMemoryBudget(*loaded);
+    loadDatabase(*loaded);
+    LiveDatabase live(loaded);
     while(true) {
-        QuestionsDatabase database;
-        loadDatabase(database);
+        shared_ptr<const QuestionsDatabase> database = live.current();
+        Session session(database);
+        TurnPipeline pipeline(session);
         getLine("Hit enter when you have selected a word for me to guess!");
         for(int i = 1; i <= maxNumQuestions; i++) {
             string question;
-            if(database.getNextQuestion(question, i)) {
+            if(pipeline.getNextQuestion(question, i)) {
                 if(getYesOrNo("Is the word that you were thinking of: " + question)) {
                     cout << "The computer wins agains!!!" << endl;
                     break;
                 } else {
                     cout << "That is unfortunate.  Let me think." << endl;
-                    database.removeIncorrectGuess(question);
+                    pipeline.removeIncorrectGuess(question);
                 }
             } else {
                 if(question == SENTINEL) {
-                    giveUp(database);
+                    pipeline.cancel();
+                    giveUp(live, *database, session);
                     break;
                 } else {
+                    cout << "Hmm.. Ok Let me think..." << endl;
                     cout << "Does it fit in the category ";
-                    database.updateDatabase(getYesOrNo(question + "?"), question, i);
+                    pipeline.updateDatabase(getYesOrNo(question + "?"), question, i);
                 }
             }
-            if(i == maxNumQuestions) giveUp(database);
+            if(i == maxNumQuestions) {
+                pipeline.cancel();
+                giveUp(live, *database, session);
+            }
         }
+        pipeline.cancel();
+        if(Instrument::enabled) Instrument::writeText(cerr);
         if(!getYesOrNo("Would you like to play again?")) break;
         cout << endl;
     }
 }
 
-/** Main */
+/**
+ * Function: serveGames
+ * --------------------
+ * Loads the database or snapshot named by the server variable once, and then plays games for other
+ * programs over stdin and stdout instead of with the user.  See SessionServer.h for the commands.
+ */
+void serveGames(const string& filename) {
+    shared_ptr<QuestionsDatabase> database = make_shared<QuestionsDatabase>();
+    database->setNumThreads(numSearchThreads);
+    setMemoryBudget(*database);
+    bool loaded = endsWith(filename, ".tsv")? database->readFile(filename): database->readSnapshot(filename);
+    if(!loaded) error("Could not open " + filename);
+    LiveDatabase live(database);
+    SessionServer server(live);
+    server.serve(cin, cout);
+}
+
+/**
+ * Main
+ * ----
+ * Plays the game with the user, unless the server variable is set in the environment, in which case
+ * it serves games to other programs instead, or the benchmark variable is set, in which case it plays
+ * the benchmark it describes (see Benchmark.h) and prints the results as JSON.  Either way, the budget variable
+ * can cap the memory the database's columns take.
+ */
 int main() {
+    const char* serverFile = getenv(serverVariable);
+    if(serverFile != NULL) {
+        serveGames(serverFile);
+        return 0;
+    }
+    const char* benchmarkDescription = getenv(benchmarkVariable);
+    if(benchmarkDescription != NULL) {
+        Benchmark benchmark(benchmarkDescription);
+        if(!benchmark.run(cout)) error("Could not open the benchmark database.");
+        return 0;
+    }
     printRules();
     manageGame();
     return 0;
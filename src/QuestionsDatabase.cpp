@@ -4,273 +4,1064 @@
  * QuestionsDatabase
  * --------------
  * The database class parses the questions and answers into a format that is easy to access
- * and manipulate.  It also is responsible for determining the best questions to ask so that the
- * response to the question evenly divides the possibilities, so that the computer can figure out
- * what they word is that the user is thinking of. It also updates the probabilites for each answer after each response and
- * refines the list by removing outliers that are no longer possibilities.
+ * and manipulate.  Once it is loaded it never changes, so one database can be shared by any
+ * number of Sessions (games) at once, each of which only keeps track of its own progress.
+ * New answers and questions are added by copying the database and appending to the copy (see
+ * LiveDatabase).  The copy shares the incidence columns and the answers' lists of questions with
+ * the original, and only clones the ones the appends write to, so appending never rebuilds the
+ * matrix and never changes what sessions playing against the original see.  The rest is copied
+ * whole: the names, the answers' sorted order and ranks, and each question's support, which is a
+ * few passes over the answers and questions for every copy.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <unordered_map>
 #include "fstream"
 #include "console.h"
 #include "filelib.h"
+#include "simpio.h"
 #include "strlib.h"
 #include "QuestionsDatabase.h"
-#include "hashmap.h"
 #include "tokenscanner.h"
-#include "dividemap.h"
+#include "error.h"
+#include "TsvLoader.h"
+#include "Snapshot.h"
+#include "instrument.h"
 using namespace std;
 
 /* Constants */
-static const string headerOne = "WIKICAT";
-static const string headerTwo = "WORDNET";
-static const int initialSize = 500;
-static const int maxNumQuestions = 20;
-static const string SENTINEL = "EMPTY_SET";
-static const double thresholdValue = 0.75;
-static const int minNumPossibilities = 3;
-static const int questionsScalingFactor = 5;
-static const int answersScalingFactor = 2;
+static const int answerKeyPageSize = 100;
+static const int answersPerLine = 5;
+static const int shortNameLength = 5;
+static const int maxSuggestionEdits = 2;
+static const double residentShare = 0.5;
+static const uint64_t checksumSeed = 14695981039346656037ull;
+static const uint64_t checksumPrime = 1099511628211ull;
+
+/* Mixes one 8 byte word into a checksum. */
+static inline uint64_t mixWord(uint64_t checksum, uint64_t word) {
+    return (checksum ^ word) * checksumPrime;
+}
+
+/* Mixes a name into a checksum, a byte at a time, followed by its length so that names cannot run together. */
+static uint64_t mixName(uint64_t checksum, string_view name) {
+    for(char c: name)
+        checksum = mixWord(checksum, static_cast<unsigned char>(c));
+    return mixWord(checksum, name.length());
+}
 
 /**
  * Function: QuestionsDatabase::QuestionsDatabase
  * ----------------------------------------------
- * Initializes a dynamically allocated SparseGrid with the inital dimensions defined in the constants.
+ * Starts with an empty database.  The incidence matrix is sized once the number of answers and questions is known.
  */
-QuestionsDatabase::QuestionsDatabase() {
-    boolGrid = new SparseGrid<bool>(initialSize, initialSize);
+QuestionsDatabase::QuestionsDatabase() :
+    epoch(0), contentChecksum(checksumSeed), minQuestionSupport(1), maxQuestionShare(1.0), memoryBudget(0), offloadedRows(0) {
 };
 
 /**
  * Function: QuestionsDatabase::~QuestionsDatabase
  * -----------------------------------------------
- * The destructor deletes the dynamically allocated SparseGrid to free up memory on the heap.
+ * The search workers are shared with every copy of the database, and are stopped once the last of them is gone.
  */
 QuestionsDatabase::~QuestionsDatabase() {
-    delete boolGrid;
 };
 
 /**
- * Function: QuestionsDatabase::removeIncorrectGuess
+ * Function: QuestionsDatabase::setNumThreads
+ * ------------------------------------------
+ * Sets how many threads load files and search for the next question.  The calling thread always takes part in
+ * the work, so one thread (or fewer) means everything runs serially and no workers are started.  The workers are
+ * shared by every session playing against this database.
+ */
+void QuestionsDatabase::setNumThreads(int numThreads) {
+    searchPool.reset((numThreads > 1)? new ThreadPool(numThreads - 1): NULL);
+}
+
+/**
+ * Function: QuestionsDatabase::setQuestionBounds
+ * ----------------------------------------------
+ * Sets which questions are kept when a file is read: only those that at least minSupport answers fit, and that
+ * at most maxShare of the answers fit.  A question that every answer fits (or none does) can never split the
+ * candidates, so it is always dropped; by default nothing else is.
+ */
+void QuestionsDatabase::setQuestionBounds(int minSupport, double maxShare) {
+    minQuestionSupport = minSupport;
+    maxQuestionShare = maxShare;
+}
+
+/**
+ * Function: QuestionsDatabase::setMemoryBudget
+ * --------------------------------------------
+ * Sets how many bytes the relation between answers and questions may take once a file or snapshot is read, or 0
+ * (the default) to keep every column in memory.  The answers' lists of questions are always kept in memory, since
+ * every dropped candidate walks its list, so they are charged against the budget first; if they take all of it,
+ * every column is kept on disk.  Half of what is left goes to the columns that split the answers most evenly,
+ * which are the ones asked near the start of every game, and those stay in memory.  The rest of the columns
+ * are kept on disk and read through a ColumnCache, which holds the ones used most recently in the other half.
+ * A text file is still read whole before its columns are moved to disk; a snapshot only ever reads the columns
+ * that stay in memory, and reads the others from the snapshot itself, which must not be changed while the
+ * database is in use.
+ */
+void QuestionsDatabase::setMemoryBudget(size_t bytes) {
+    memoryBudget = bytes;
+}
+
+/**
+ * Function: QuestionsDatabase::countSupport
+ * -----------------------------------------
+ * Counts, for every question, how many answers fit it.  This is done once the database is loaded, and is
+ * where every new session's counts of candidates per question start from.
+ */
+void QuestionsDatabase::countSupport() {
+    questionSupport.clear();
+    for(int question = 0; question < questionNames.size(); question++)
+        questionSupport.add(incidence.column(question).count());
+}
+
+/**
+ * Function: QuestionsDatabase::rankAnswers
+ * ----------------------------------------
+ * Numbers the answers in alphabetical order, so that sessions can break ties between candidates by comparing
+ * two numbers instead of two names.  The answers in that order are kept as well, so that an appended answer's
+ * rank can be found by binary search.
+ */
+void QuestionsDatabase::rankAnswers() {
+    rankedAnswers.resize(answerNames.size());
+    for(int answer = 0; answer < answerNames.size(); answer++)
+        rankedAnswers[answer] = answer;
+    sort(rankedAnswers.begin(), rankedAnswers.end(), [this](int first, int second) {
+        return answerNames.name(first) < answerNames.name(second);
+    });
+    answerRanks = Vector<int>(answerNames.size(), 0);
+    for(int rank = 0; rank < int(rankedAnswers.size()); rank++)
+        answerRanks[rankedAnswers[rank]] = rank;
+}
+
+/**
+ * Function: QuestionsDatabase::numAnswers
+ * ---------------------------------------
+ * Returns the number of answers in the database.
+ */
+int QuestionsDatabase::numAnswers() const {
+    return answerNames.size();
+}
+
+/**
+ * Function: QuestionsDatabase::numQuestions
+ * -----------------------------------------
+ * Returns the number of questions in the database.
+ */
+int QuestionsDatabase::numQuestions() const {
+    return questionNames.size();
+}
+
+/**
+ * Function: QuestionsDatabase::getAnswerNames
+ * -------------------------------------------
+ * Returns the table that maps answers to their indices and back.
+ */
+const InternTable& QuestionsDatabase::getAnswerNames() const {
+    return answerNames;
+}
+
+/**
+ * Function: QuestionsDatabase::getQuestionNames
+ * ---------------------------------------------
+ * Returns the table that maps questions to their indices and back.
+ */
+const InternTable& QuestionsDatabase::getQuestionNames() const {
+    return questionNames;
+}
+
+/**
+ * Function: QuestionsDatabase::fits
+ * ---------------------------------
+ * Returns whether or not the answer fits the question.
+ */
+bool QuestionsDatabase::fits(int answer, int question) const {
+    if(incidence.isResident(question)) return incidence.get(answer, question);
+    return getQuestionColumn(question)->test(answer);
+}
+
+/**
+ * Function: QuestionsDatabase::questionsOf
+ * ----------------------------------------
+ * Returns the indices of every question the answer fits.
+ */
+const Vector<int>& QuestionsDatabase::questionsOf(int answer) const {
+    return *answerQuestions[answer];
+}
+
+/**
+ * Function: QuestionsDatabase::getQuestionColumn
+ * ----------------------------------------------
+ * Returns the answers that fit the question.  An offloaded column is read through the column cache, and the
+ * pointer keeps it alive for as long as it is held, even if the cache drops it.
+ */
+shared_ptr<const HybridColumn> QuestionsDatabase::getQuestionColumn(int question) const {
+    if(incidence.isResident(question)) return incidence.share(question);
+    return columnCache->get(columnOffsets[question], offloadedRows);
+}
+
+/**
+ * Function: QuestionsDatabase::getOffloadedQuestions
+ * --------------------------------------------------
+ * Returns a bit for every question that is set if its column is kept on disk (see setMemoryBudget).
+ */
+const BitVector& QuestionsDatabase::getOffloadedQuestions() const {
+    return offloaded;
+}
+
+/**
+ * Function: QuestionsDatabase::offloadedFingerprint
  * -------------------------------------------------
- * Eliminates the incorrect guess from the subset of answers which the program is still considering.
+ * Returns a number that tells which columns are on disk, or 0 if none are.  Sessions ask different questions
+ * depending on which columns are on disk, so an opening tree is only followed if it was planned with the same ones.
  */
-void QuestionsDatabase::removeIncorrectGuess(const string& guess) {
-    probabilities.refineSubset(guess);
+uint64_t QuestionsDatabase::offloadedFingerprint() const {
+    if(offloaded.count() == 0) return 0;
+    return offloaded.hash() | 1;
 }
 
 /**
- * Function: QuestionsDatabase::contains
+ * Function: QuestionsDatabase::matrixMemoryUsage
+ * ----------------------------------------------
+ * Returns roughly how many bytes the incidence matrix takes.
+ */
+size_t QuestionsDatabase::matrixMemoryUsage() const {
+    return incidence.memoryUsage();
+}
+
+/**
+ * Function: QuestionsDatabase::questionListMemoryUsage
+ * ----------------------------------------------------
+ * Returns roughly how many bytes the answers' lists of questions take, which is about as much as the sparse
+ * columns do, since both hold every edge once.
+ */
+size_t QuestionsDatabase::questionListMemoryUsage() const {
+    size_t bytes = answerQuestions.size() * (sizeof(shared_ptr<Vector<int> >) + sizeof(Vector<int>));
+    for(const shared_ptr<Vector<int> >& questions: answerQuestions)
+        bytes += questions->size() * sizeof(int);
+    return bytes;
+}
+
+/**
+ * Function: QuestionsDatabase::columnBudget
+ * -----------------------------------------
+ * Returns the part of the memory budget that is left for the columns once the answers' lists are paid for.
+ */
+size_t QuestionsDatabase::columnBudget() const {
+    return memoryBudget - min(questionListMemoryUsage(), memoryBudget);
+}
+
+/**
+ * Function: QuestionsDatabase::columnCacheStats
+ * ---------------------------------------------
+ * Returns how often offloaded columns were found in the column cache, and how long reading the others took.
+ * Everything is 0 when no column is offloaded.
+ */
+ColumnCache::Stats QuestionsDatabase::columnCacheStats() const {
+    if(columnCache == NULL) return ColumnCache::Stats{0, 0, 0, 0.0, 0, 0};
+    return columnCache->stats();
+}
+
+/**
+ * Function: QuestionsDatabase::getQuestionSupport
+ * -----------------------------------------------
+ * Returns, for every question index, the number of answers that fit the question.
+ */
+const Vector<int>& QuestionsDatabase::getQuestionSupport() const {
+    return questionSupport;
+}
+
+/**
+ * Function: QuestionsDatabase::getAnswerRanks
+ * -------------------------------------------
+ * Returns, for every answer index, the answer's position among the answers in alphabetical order.
+ */
+const Vector<int>& QuestionsDatabase::getAnswerRanks() const {
+    return answerRanks;
+}
+
+/**
+ * Function: QuestionsDatabase::getSearchPool
+ * ------------------------------------------
+ * Returns the workers that sessions can use to search for questions, or NULL if there are none.
+ */
+ThreadPool* QuestionsDatabase::getSearchPool() const {
+    return searchPool.get();
+}
+
+/**
+ * Function: QuestionsDatabase::getOpeningTree
+ * -------------------------------------------
+ * Returns the opening tree, which is empty unless one was planned or read from a snapshot.
+ */
+const DecisionTree& QuestionsDatabase::getOpeningTree() const {
+    return openingTree;
+}
+
+/**
+ * Function: QuestionsDatabase::setOpeningTree
+ * -------------------------------------------
+ * Stores a tree planned by Session::planOpenings, so that sessions started from now on can follow it and so
+ * that it is saved with the next snapshot.
+ */
+void QuestionsDatabase::setOpeningTree(const DecisionTree& tree) {
+    openingTree = tree;
+}
+
+/**
+ * Function: QuestionsDatabase::getEpoch
  * -------------------------------------
- * Returns whether or not the given string is contained within the total database of possible solutions.
+ * Returns the number of the epoch this database belongs to, starting from 0 when it was loaded.
+ */
+int QuestionsDatabase::getEpoch() const {
+    return epoch;
+}
+
+/**
+ * Function: QuestionsDatabase::fingerprint
+ * ----------------------------------------
+ * Returns a fingerprint of the answers and questions in this epoch, which is what a saved game needs to be
+ * played on.  It is a checksum of the columns and names the database was loaded with (the same whether they came from
+ * a text file or from a snapshot of it, see checksumColumn and checksumNames), with every answer, question and
+ * pair appended since then mixed in, in the order they were added.  So two databases with the same fingerprint
+ * hold the same answers and questions under the same indices, unless their checksums collide.
  */
-bool QuestionsDatabase::contains(const string& response) {
-    return probabilities.containsKey(response);
+uint64_t QuestionsDatabase::fingerprint() const {
+    return contentChecksum;
 }
 
 /**
- * Function: QuestionsDatabase::findDifference
+ * Function: QuestionsDatabase::checksumColumn
  * -------------------------------------------
- * This function is called whenever the program cannot figure out what the user was thinking of
- * when the word is contained within the database.  It will iterate through the responses to
- * the questions that the program asked, and will alert the user of the questions that they
- * answered incorrectly for the solution.  If the user answered everything correctly, and the program
- * still does not answer it correctly (due to bad dataset), it will prompt the user with a different
- * statement.
- */
-void QuestionsDatabase::findDifference(const string& response) {
-    int counter = 0;
-    while(!questionsAsked.isEmpty()) {
-        questionInfo question = questionsAsked.dequeue();
-        if(((*boolGrid)[probabilities.get(response).index][question.index] == true && !question.response) ||
-                ((*boolGrid)[probabilities.get(response).index][question.index] != true && question.response)) {
-            cout << "You incorrectly answered " << question.question << endl;
-            counter++;
-        }
-    }
-    if(counter == 0) cout << "I was about to get to that one.." << endl;
+ * Mixes the next column loaded into the checksum behind fingerprint.  The columns are mixed in as they are
+ * loaded, in order, and then the names.
+ */
+void QuestionsDatabase::checksumColumn(const HybridColumn& column) {
+    contentChecksum = mixWord(contentChecksum, column.hash());
 }
 
 /**
- * Function: QuestionsDatabase::removeHeaders
+ * Function: QuestionsDatabase::checksumNames
  * ------------------------------------------
- * This function will remove the two main headers found within the sample file.  It will
- * cut out one of the two headers, as well as the series of digits found with header two.
+ * Mixes the names of the answers and questions, and the labels that were merged into other questions, into the
+ * checksum behind fingerprint, once every column has been loaded.
+ */
+void QuestionsDatabase::checksumNames() {
+    for(int answer = 0; answer < answerNames.size(); answer++)
+        contentChecksum = mixName(contentChecksum, answerNames.name(answer));
+    for(int question = 0; question < questionNames.size(); question++)
+        contentChecksum = mixName(contentChecksum, questionNames.name(question));
+    for(int label = 0; label < mergedNames.size(); label++)
+        contentChecksum = mixWord(mixName(contentChecksum, mergedNames.name(label)), mergedInto[label]);
+}
+
+/**
+ * Function: QuestionsDatabase::startNextEpoch
+ * -------------------------------------------
+ * Marks a copy of a database as the next epoch, before anything is appended to it.  The opening tree was planned
+ * for the answers and questions of the last epoch, so it is dropped; it can be planned again for the new one.
  */
-void QuestionsDatabase::removeHeaders(string& question) {
-    if(stringContains(question, headerOne)) {
-        question = trim(question.substr(headerOne.length()));
+void QuestionsDatabase::startNextEpoch() {
+    epoch++;
+    openingTree = DecisionTree();
+}
+
+/**
+ * Function: QuestionsDatabase::appendAnswer
+ * -----------------------------------------
+ * Adds the answer under the next answer index if it is not already in the database, without any questions.
+ * The matrix only gains a row, which does not touch any of its columns.  Its rank is found by binary search over
+ * the answers in alphabetical order, and every answer that comes after it moves back one rank, which is a pass
+ * over the ranks but does not compare any names.  The name is mixed into the fingerprint.
+ */
+void QuestionsDatabase::appendAnswer(const string& answer) {
+    if(answerNames.find(answer) != -1) return;
+    incidence.resize(answerNames.size() + 1, questionNames.size());
+    addAnswer(answer);
+    int added = answerNames.size() - 1;
+    contentChecksum = mixName(contentChecksum, answer);
+    answerIndex.insert(answerNames, added);
+    vector<int>::iterator position = lower_bound(rankedAnswers.begin(), rankedAnswers.end(), answer,
+                                                 [this](int other, const string& name) {
+        return answerNames.name(other) < name;
+    });
+    int rank = position - rankedAnswers.begin();
+    rankedAnswers.insert(position, added);
+    for(int other = 0; other < answerRanks.size(); other++) {
+        if(answerRanks[other] >= rank) answerRanks[other]++;
     }
-    if(stringContains(question, headerTwo)) {
-        question = trim(question.substr(headerTwo.length()));
-        while(isdigit(question[question.length() - 1]))
-            question = question.substr(0, question.length() - 1);
+    answerRanks.add(rank);
+}
+
+/**
+ * Function: QuestionsDatabase::appendEdge
+ * ---------------------------------------
+ * Records that the answer fits the question, adding either of them if it is new.  A label that was merged into a
+ * duplicate question at load time stands for the question it was merged into (see resolveQuestion).  A new
+ * question gets a new, empty column, and the only column that is written (and so cloned, if it is shared) is the
+ * question's own.  An offloaded column is brought back into memory first, and stays there.  A new question's
+ * name and a new pair are mixed into the fingerprint; a pair the database already has changes nothing.
+ */
+void QuestionsDatabase::appendEdge(const string& answer, const string& question) {
+    appendAnswer(answer);
+    int col = resolveQuestion(question);
+    if(col == -1) {
+        incidence.resize(answerNames.size(), questionNames.size() + 1);
+        addQuestion(question);
+        contentChecksum = mixName(contentChecksum, question);
+        col = questionNames.size() - 1;
+        questionSupport.add(0);
+        offloaded.resize(questionNames.size());
     }
+    if(!incidence.isResident(col)) restoreColumn(col);
+    int row = answerNames.find(answer);
+    if(!incidence.get(row, col)) {
+        addEdge(row, col);
+        contentChecksum = mixWord(contentChecksum, uint64_t(row) << 32 | uint32_t(col));
+        questionSupport[col]++;
+    }
+}
+
+/**
+ * Function: QuestionsDatabase::resolveQuestion
+ * --------------------------------------------
+ * Returns the index of the question with the label, or of the question it was merged into by pruneQuestions, or
+ * -1 if there is neither.
+ */
+int QuestionsDatabase::resolveQuestion(const string& question) const {
+    int index = questionNames.find(question);
+    if(index != -1) return index;
+    int merged = mergedNames.find(question);
+    return (merged == -1)? -1: mergedInto[merged];
+}
+
+/**
+ * Function: QuestionsDatabase::contains
+ * -------------------------------------
+ * Returns whether or not the given string is contained within the total database of possible solutions, the
+ * way findAnswer looks it up.
+ */
+bool QuestionsDatabase::contains(const string& response) const {
+    return findAnswer(response) != -1;
+}
+
+/**
+ * Function: QuestionsDatabase::findAnswer
+ * ---------------------------------------
+ * Returns the index of the answer the user meant, or -1 if there is none.  An exact match comes first;
+ * otherwise case, underscores in place of spaces and whitespace at either end are ignored.
+ */
+int QuestionsDatabase::findAnswer(const string& response) const {
+    INSTRUMENT_TIMER("find_answer");
+    int answer = answerNames.find(response);
+    if(answer != -1) return answer;
+    return answerIndex.find(answerNames, trim(response));
+}
+
+/**
+ * Function: QuestionsDatabase::suggestAnswers
+ * -------------------------------------------
+ * Returns up to maxSuggestions answers the user may have meant by a name that findAnswer did not find.  First
+ * come the answers that are a couple of typos away (only one for short names, which would otherwise match
+ * too much), closest first, and then the answers that start with what the user typed.
+ */
+Vector<string> QuestionsDatabase::suggestAnswers(const string& response, int maxSuggestions) const {
+    INSTRUMENT_TIMER("suggest_answers");
+    Vector<string> suggestions;
+    string query = trim(response);
+    if(query.empty()) return suggestions;
+    int maxEdits = (int(query.length()) <= shortNameLength)? 1: maxSuggestionEdits;
+    vector<int> answers;
+    answerIndex.findNear(answerNames, query, maxEdits, maxSuggestions, answers);
+    pair<int, int> range = answerIndex.prefixRange(answerNames, query);
+    for(int position = range.first; position < range.second && int(answers.size()) < maxSuggestions; position++) {
+        int answer = answerIndex.at(position);
+        if(find(answers.begin(), answers.end(), answer) == answers.end()) answers.push_back(answer);
+    }
+    for(int answer: answers)
+        suggestions.add(string(answerNames.name(answer)));
+    return suggestions;
 }
 
 /**
  * Function: QuestionsDatabase::showAnswerKey
  * ------------------------------------------
- * This is called to display all of the possible answers that the program knows of which the user can
- * pick for the game.  It will space them all out for easy readability.
- */
-void QuestionsDatabase::showAnswerKey() {
-    int counter = 0;
-    Set<string> answers = probabilities.getMapKeys();
-    for(string answer: answers) {
-        if(counter++ % 5 == 0) cout << endl << endl;
-        cout << answer << "     ";
+ * This is called to display the possible answers that the program knows of which the user can pick for the
+ * game, in alphabetical order.  Only the answers that start with the prefix are shown (all of them if it is
+ * empty), ignoring case.  It will space them out for easy readability, and after every page it asks whether
+ * the user wants to see more.
+ */
+void QuestionsDatabase::showAnswerKey(const string& prefix) const {
+    pair<int, int> range = answerIndex.prefixRange(answerNames, trim(prefix));
+    if(range.first == range.second) {
+        cout << "There are no answers that start with " << prefix << endl;
+        return;
+    }
+    for(int position = range.first; position < range.second; position++) {
+        int shown = position - range.first;
+        if(shown > 0 && shown % answerKeyPageSize == 0) {
+            cout << endl << endl;
+            if(!getYesOrNo("Would you like to see more?")) return;
+        }
+        if(shown % answersPerLine == 0) cout << endl << endl;
+        cout << answerNames.name(answerIndex.at(position)) << "     ";
     }
     cout << endl << endl;
 }
 
 /**
- * Function: QuestionsDatabase::readKey
+ * Function: QuestionsDatabase::sizeDatabase
+ * -----------------------------------------
+ * Sizes the incidence matrix for exactly the given number of answers and questions.  Every loader knows both
+ * counts before it adds the first answer, so no column ever has to be copied into a bigger matrix; each one
+ * only grows as the answers that fit it are added.
+ */
+void QuestionsDatabase::sizeDatabase(int numAnswers, int numQuestions) {
+    INSTRUMENT_COUNT("matrix_sized_bits", uint64_t(numAnswers) * numQuestions);
+    incidence.resize(numAnswers, numQuestions);
+    offloaded = BitVector(numQuestions);
+}
+
+/**
+ * Function: QuestionsDatabase::reserveNames
+ * -----------------------------------------
+ * Makes room for the given answers and questions in the intern tables, so that the arenas holding their
+ * characters are allocated once.
+ */
+void QuestionsDatabase::reserveNames(const vector<string_view>& answers, const vector<string_view>& categories) {
+    size_t answerChars = 0, questionChars = 0;
+    for(string_view name: answers) answerChars += name.length();
+    for(string_view question: categories) questionChars += question.length();
+    answerNames.reserve(answers.size(), answerChars);
+    questionNames.reserve(categories.size(), questionChars);
+}
+
+/**
+ * Function: QuestionsDatabase::addAnswer
+ * --------------------------------------
+ * Interns a new answer under the next answer index.  The matrix must already have been sized to hold it.
+ */
+void QuestionsDatabase::addAnswer(string_view name) {
+    answerNames.intern(name);
+    answerQuestions.add(make_shared<Vector<int> >());
+}
+
+/**
+ * Function: QuestionsDatabase::addQuestion
+ * ----------------------------------------
+ * Interns a new question under the next question index.  The matrix must already have been sized to hold it.
+ */
+void QuestionsDatabase::addQuestion(string_view question) {
+    questionNames.intern(question);
+}
+
+/**
+ * Function: QuestionsDatabase::addEdge
  * ------------------------------------
- * This will seperate the string from within a token market with '<' and '>'.
+ * Sets the bit for the answer and question in the incidence matrix, recording the question in the
+ * answer's list of questions the first time the pair is seen.
  */
-void QuestionsDatabase::readKey(ifstream& input, string& str, char& curr) {
-    curr = input.get();
-    while(curr != '>') {
-        str += (curr == '_')? ' ': curr;
-        curr = input.get();
+void QuestionsDatabase::addEdge(int row, int col) {
+    if(!incidence.get(row, col)) {
+        incidence.set(row, col);
+        writableQuestionsOf(row).add(col);
     }
 }
 
 /**
- * Function: QuestionsDatabase::bestGuess
- * --------------------------------------
- * This function is called when the computer is forced to make a guess as to what
- * the word is that the user is thinking of.  It will return the answer from the remaining subset
- * with the highest probability of being correct.
- */
-string QuestionsDatabase::bestGuess() {
-    string mostProbable = "";
-    int highestProbability = 0.0;
-    Set<string> remainingAnswers = probabilities.getSubMapKeys();
-    for(string answer: remainingAnswers) {
-        if(probabilities.get(answer).prob > highestProbability) {
-            mostProbable = answer;
-            highestProbability = probabilities[answer].prob;
+ * Function: QuestionsDatabase::writableQuestionsOf
+ * ------------------------------------------------
+ * Returns the answer's list of questions for writing, first cloning it if another copy of the database shares it.
+ */
+Vector<int>& QuestionsDatabase::writableQuestionsOf(int answer) {
+    if(answerQuestions[answer].use_count() > 1)
+        answerQuestions[answer] = make_shared<Vector<int> >(*answerQuestions[answer]);
+    return *answerQuestions[answer];
+}
+
+/**
+ * Function: QuestionsDatabase::readFile
+ * This will read in the file and will store all of the appropriate information.  The file is parsed
+ * by the TsvLoader (sharded across the search workers when the file is large), which hands back every
+ * unique answer and question (already normalized and numbered in the order they first appear) along
+ * with the answer/question pairs.  Since the loader has already counted the answers and questions, the
+ * incidence matrix (and the arenas the names are interned in) are sized exactly before anything is added.
+ * Each answer and each question is stored in its own intern table.  Each pair then sets the bit for that
+ * particular quesiton and answer in the incidence matrix.  Once everything is read, it sorts the answers for
+ * looking up names and ranks them alphabetically, counts the answers that fit each question, and prunes the
+ * questions that are duplicates or fall outside the support bounds.  With a memory budget, the columns that do
+ * not fit in it are then moved to disk.  By doing this, it allows for O(1) look up for a quesiton and answer.
+ * Returns false if the file could not be opened.
+ */
+bool QuestionsDatabase::readFile(const string& filename) {
+    INSTRUMENT_TIMER("read_file");
+    cout << "Reading in File..." << endl << endl;
+    TsvLoader loader;
+    if(!loader.open(filename)) return false;
+    loader.parse(searchPool.get());
+    sizeDatabase(loader.getAnswers().size(), loader.getCategories().size());
+    reserveNames(loader.getAnswers(), loader.getCategories());
+    for(string_view name: loader.getAnswers())
+        addAnswer(name);
+    for(string_view question: loader.getCategories())
+        addQuestion(question);
+    for(const pair<int, int>& edge: loader.getEdges())
+        addEdge(edge.first, edge.second);
+    answerIndex.build(answerNames);
+    rankAnswers();
+    countSupport();
+    loader.printStats(cout);
+    pruneQuestions();
+    for(int col = 0; col < questionNames.size(); col++)
+        checksumColumn(incidence.column(col));
+    checksumNames();
+    if(memoryBudget > 0) offloadColumns();
+    return true;
+}
+
+/**
+ * Function: QuestionsDatabase::pruneQuestions
+ * -------------------------------------------
+ * Shrinks the questions that every turn has to scan.  Questions with exactly the same answers as an earlier
+ * question are merged into it, keeping the earlier one's label.  The search breaks ties in favor of the lowest
+ * index, so the kept question is the one that would have been asked first, and asking any of the others later
+ * would only have repeated it.  The merged labels are remembered along with the question they were merged into,
+ * so that appending to one of them later appends to that question.  Questions outside the support bounds are
+ * dropped.
+ * The kept questions are renumbered in their original order, the columns are moved into place without copying
+ * their bits, and the answers' lists of questions are renumbered to match.  It reports how much was pruned.
+ */
+void QuestionsDatabase::pruneQuestions() {
+    INSTRUMENT_TIMER("prune_questions");
+    int numQuestions = questionNames.size();
+    int maxSupport = min(int(maxQuestionShare * answerNames.size()), answerNames.size() - 1);
+    vector<int> kept;
+    Vector<int> newIndex(numQuestions, -1);
+    unordered_map<uint64_t, vector<int> > keptByHash;
+    vector<pair<int, int> > merged; // a duplicate and the earlier question it is merged into
+    int numDuplicates = 0, numRare = 0, numCommon = 0;
+    for(int question = 0; question < numQuestions; question++) {
+        if(questionSupport[question] < max(minQuestionSupport, 1)) {
+            numRare++;
+            continue;
+        }
+        if(questionSupport[question] > maxSupport) {
+            numCommon++;
+            continue;
+        }
+        const HybridColumn& column = incidence.column(question);
+        vector<int>& sameHash = keptByHash[column.hash()];
+        int original = -1;
+        for(int other: sameHash) {
+            if(incidence.column(other).equals(column)) {
+                original = other;
+                break;
+            }
+        }
+        if(original != -1) {
+            merged.push_back(make_pair(question, original));
+            numDuplicates++;
+            continue;
+        }
+        sameHash.push_back(question);
+        newIndex[question] = kept.size();
+        kept.push_back(question);
+    }
+    for(const pair<int, int>& duplicate: merged) {
+        mergedNames.intern(questionNames.name(duplicate.first));
+        mergedInto.add(newIndex[duplicate.second]);
+    }
+    if(int(kept.size()) < numQuestions) {
+        InternTable keptNames;
+        Vector<int> keptSupport;
+        for(int question: kept) {
+            keptNames.intern(questionNames.name(question));
+            keptSupport.add(questionSupport[question]);
+        }
+        questionNames = keptNames;
+        questionSupport = keptSupport;
+        incidence.keepColumns(kept);
+        offloaded = BitVector(kept.size());
+        for(int answer = 0; answer < answerNames.size(); answer++) {
+            Vector<int>& questions = writableQuestionsOf(answer);
+            Vector<int> renumbered;
+            for(int question: questions) {
+                if(newIndex[question] != -1) renumbered.add(newIndex[question]);
+            }
+            questions = renumbered;
         }
     }
-    return mostProbable;
+    cout << "Pruned the questions from " << numQuestions << " to " << kept.size() << " (" << numDuplicates
+         << " duplicates merged, " << numRare << " fit too few answers, " << numCommon << " fit too many): "
+         << (numQuestions == 0? 100: 100 * kept.size() / numQuestions) << "% of the scan is left" << endl;
+}
+
+/**
+ * Function: printResidency
+ * ------------------------
+ * Reports how many columns were kept in memory under the memory budget, how much room they take, and how much
+ * the answers' lists of questions took out of the budget first.
+ */
+static void printResidency(int numResident, int numQuestions, size_t residentBytes, size_t listBytes,
+                           size_t budget) {
+    cout << "Kept " << numResident << " of the " << numQuestions << " columns in memory (" << residentBytes
+         << " bytes, and " << listBytes << " bytes of question lists, of a " << budget
+         << " byte budget); the rest are read from disk as they are needed" << endl;
+    if(listBytes >= budget) cout << "The question lists alone take more than the budget" << endl;
 }
 
 /**
- * Function: QuestionsDatabase::updateDatabase
+ * Function: QuestionsDatabase::chooseResident
  * -------------------------------------------
- * This will update the internal database after the user answers the given question.  It will first add
- * the information with the last question into the questionsAsked queue, which is called only when
- * the user answers questions incorrectly.  This function will next remove the question from the map, so
- * as to not ask the same question more than once.  It then iteratively goes through the remaining possible
- * answers, and will update the answerInfo for each answer where the probabilites are increased for each
- * answer that corresponds with the response from the user for the question that the computer asked.
- * It keeps track of all of the probabilites that fall below the threshold value, and will then
- * refine the subset of the dividemap so that it can eliminate outliers.
- */
-void QuestionsDatabase::updateDatabase(bool response, const string& question, int numQuestions) {
-    questionInfo lastQuestion = {question, questions[question], response};
-    questionsAsked.enqueue(lastQuestion);
-    int questionIndex = questions[question];
-    questions.remove(question);
-    Set<string> toRemove;
-    Set<string> currentCandidates = probabilities.getSubMapKeys();
-    for(string answer: currentCandidates) {
-        if(((*boolGrid)[probabilities[answer].index][questionIndex] == true && response) ||
-                ((*boolGrid)[probabilities[answer].index][questionIndex] != true && !response)) probabilities[answer].prob++;
-        if((double(probabilities[answer].prob) / double(numQuestions)) < thresholdValue) toRemove += answer;
+ * Picks the columns that stay in memory, given how many bytes each of them takes: the ones whose answers are
+ * closest to half of all the answers come first, since they are the ones asked near the start of every game,
+ * and any column that still fits in the resident half of the column budget (see columnBudget) is kept.
+ * Returns a bit for each kept column, and stores how many bytes they take in residentBytes.
+ */
+BitVector QuestionsDatabase::chooseResident(const vector<size_t>& columnBytes, size_t& residentBytes) const {
+    vector<int> order(questionNames.size());
+    for(int question = 0; question < questionNames.size(); question++)
+        order[question] = question;
+    auto splitDistance = [this](int question) {
+        return abs(0.5 - double(questionSupport[question]) / max(answerNames.size(), 1));
+    };
+    stable_sort(order.begin(), order.end(), [&splitDistance](int first, int second) {
+        return splitDistance(first) < splitDistance(second);
+    });
+    BitVector resident(questionNames.size());
+    size_t limit = size_t(columnBudget() * residentShare);
+    residentBytes = 0;
+    for(int question: order) {
+        if(residentBytes + columnBytes[question] > limit) continue;
+        resident.set(question);
+        residentBytes += columnBytes[question];
     }
-    for(string incorrectAnswer: toRemove)
-        probabilities.refineSubset(incorrectAnswer);
+    return resident;
 }
 
 /**
- * Function: QuestionsDatabase::getNextQuestion
- * --------------------------------------------
- * This deterministically finds the next question to ask the user.  It will first check to see
- * whether or not there are any remaining possibilities in the submap.  If so it will return a sentinel
- * string that alerts the main program that there are no possibilites left.  If the submap is small enough
- * or the computer is on its last question, it will return the best guess for what the user is thinking of,
- * and will return true to alert the main program that it is guessing the word and not a question.
- * Otherwise, it will iteratively go through the submap, and finds the question that most evenly splits the remaining
- * possible answer and sets it equal to the 'question' string passed in.
- */
-bool QuestionsDatabase::getNextQuestion(string& question, const int numQuestion) {
-    if(probabilities.subMapSize() == 0) {
-        question = SENTINEL;
-        return false;
+ * Function: QuestionsDatabase::offloadColumns
+ * -------------------------------------------
+ * Moves every column that does not stay in memory (see chooseResident) into a temporary column file, and lets
+ * the matrix free it.  The rest of the column budget is left to the column cache.
+ */
+void QuestionsDatabase::offloadColumns() {
+    INSTRUMENT_TIMER("offload_columns");
+    vector<size_t> columnBytes(questionNames.size());
+    for(int question = 0; question < questionNames.size(); question++)
+        columnBytes[question] = incidence.column(question).memoryUsage();
+    size_t residentBytes;
+    BitVector resident = chooseResident(columnBytes, residentBytes);
+    printResidency(resident.count(), questionNames.size(), residentBytes, questionListMemoryUsage(), memoryBudget);
+    if(resident.count() == questionNames.size()) return;
+    columnCache = make_shared<ColumnCache>(columnBudget() - min(residentBytes, columnBudget()));
+    if(!columnCache->create()) error("Could not create a column file");
+    offloadedRows = answerNames.size();
+    columnOffsets.assign(questionNames.size(), 0);
+    for(int question = 0; question < questionNames.size(); question++) {
+        if(resident.test(question)) continue;
+        columnOffsets[question] = columnCache->append(incidence.column(question), offloadedRows);
+        incidence.offload(question);
+        offloaded.set(question);
+    }
+}
+
+/**
+ * Function: QuestionsDatabase::restoreColumn
+ * ------------------------------------------
+ * Brings an offloaded column back into the matrix, as a copy that this database can write to.
+ */
+void QuestionsDatabase::restoreColumn(int question) {
+    incidence.restore(question, make_shared<HybridColumn>(*getQuestionColumn(question)));
+    offloaded.reset(question);
+}
+
+/*
+ * Writes the names in index order as a count, the offset of each name (plus the end), and then the characters.
+ * The name with a given index is looked up with nameOf(index).
+ */
+template <typename Function>
+static void writeNames(SnapshotWriter& writer, uint32_t section, int count, Function nameOf) {
+    writer.beginSection(section);
+    writer.writeWord(count);
+    uint64_t offset = 0;
+    for(int index = 0; index < count; index++) {
+        writer.writeWord(offset);
+        offset += nameOf(index).length();
     }
-    if(probabilities.subMapSize() < minNumPossibilities || numQuestion == maxNumQuestions) {
-        question = bestGuess();
-        return true;
+    writer.writeWord(offset);
+    for(int index = 0; index < count; index++)
+        writer.write(nameOf(index).data(), nameOf(index).length());
+}
+
+/* Reads a section written by writeNames, calling the function with each name in index order. */
+template <typename Function>
+static void readNames(const SnapshotReader& reader, uint32_t section, Function function) {
+    const char* bytes;
+    uint64_t length;
+    if(!reader.section(section, bytes, length) || length < sizeof(uint64_t)) error("Snapshot is missing names");
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(bytes);
+    uint64_t count = words[0];
+    if(length < (count + 2) * sizeof(uint64_t)) error("Snapshot names are truncated");
+    const uint64_t* offsets = words + 1;
+    const char* characters = bytes + (count + 2) * sizeof(uint64_t);
+    if(offsets[count] > length - (count + 2) * sizeof(uint64_t)) error("Snapshot names are truncated");
+    for(uint64_t index = 0; index < count; index++)
+        function(string_view(characters + offsets[index], offsets[index + 1] - offsets[index]));
+}
+
+/**
+ * Function: QuestionsDatabase::writeSnapshot
+ * ------------------------------------------
+ * Saves the answers, the questions and the incidence matrix to a snapshot so that it can later be opened with
+ * readSnapshot instead of parsing the text file again.  The matrix is the number of answers and questions
+ * followed by every column, each stored the way it is in memory: a word that is 0 for an array of answers or
+ * 1 for packed bits, the number of entries, and then the answers as 32 bit numbers (padded to a whole word)
+ * or a word of bits for every 64 answers.  The answers' sorted order is saved as their number followed by the
+ * 32 bit answer indices, so that it does not have to be sorted again.  If an opening tree has been planned, it
+ * is saved as well, as the rules it was planned with and the fingerprint of the columns that were on disk when
+ * it was planned (0 if there were none), followed by its nodes.  The labels that were merged into duplicate
+ * questions are saved as names, with the 32 bit index of the question each one was merged into.  Offloaded
+ * columns are read back one at a time, but not from the snapshot that is being written, since opening it for
+ * writing wipes it.  Returns whether the snapshot was written.
+ */
+bool QuestionsDatabase::writeSnapshot(const string& filename) {
+    if(columnCache != NULL && columnCache->getFilename() == filename) return false;
+    SnapshotWriter writer;
+    if(!writer.open(filename)) return false;
+    writeNames(writer, ANSWER_NAMES_SECTION, answerNames.size(),
+               [this](int index) { return answerNames.name(index); });
+    writeNames(writer, QUESTION_NAMES_SECTION, questionNames.size(),
+               [this](int index) { return questionNames.name(index); });
+    writer.beginSection(ANSWER_INDEX_SECTION);
+    writer.writeWord(answerIndex.size());
+    writer.write(answerIndex.data(), answerIndex.size() * sizeof(int32_t));
+    writer.beginSection(COLUMNS_SECTION);
+    writer.writeWord(answerNames.size());
+    writer.writeWord(questionNames.size());
+    vector<uint64_t> encoded;
+    for(int col = 0; col < questionNames.size(); col++) {
+        encoded.clear();
+        ColumnCache::encode(*getQuestionColumn(col), answerNames.size(), encoded);
+        writer.write(encoded.data(), encoded.size() * sizeof(uint64_t));
     }
-    cout << "Hmm.. Ok Let me think..." << endl;
-    string bestQuestion = "";
-    double divide = 0.0;
-    double answerKeySize = probabilities.subMapSize();
-    for(string question: questions) {
-        double counter = 0.0;
-        Set<string> currentCandidates = probabilities.getSubMapKeys();
-        for(string answer: currentCandidates)
-            if((*boolGrid)[probabilities[answer].index][questions[question]]) counter++;
-        if(abs(0.5 - (counter / answerKeySize)) < abs(0.5 - divide)) {
-            divide = counter / answerKeySize;
-            bestQuestion = question;
-        }
+    writeNames(writer, MERGED_NAMES_SECTION, mergedNames.size(),
+               [this](int index) { return mergedNames.name(index); });
+    writer.beginSection(MERGED_INTO_SECTION);
+    vector<int32_t> into(mergedInto.begin(), mergedInto.end());
+    writer.writeWord(into.size());
+    writer.write(into.data(), into.size() * sizeof(int32_t));
+    if(!openingTree.isEmpty()) {
+        double noiseRate = openingTree.getNoiseRate();
+        uint64_t noiseBits;
+        memcpy(&noiseBits, &noiseRate, sizeof(noiseBits));
+        writer.beginSection(OPENING_TREE_SECTION);
+        writer.writeWord(openingTree.getDepth());
+        writer.writeWord(openingTree.getStrategy());
+        writer.writeWord(noiseBits);
+        writer.writeWord(openingTree.getMaxMismatches());
+        writer.writeWord(openingTree.getOffloaded());
+        writer.write(openingTree.data(), openingTree.numNodes() * sizeof(int32_t));
     }
-    question = bestQuestion;
-    return false;
+    return writer.finish();
 }
 
 /**
- * Function: QuestionsDatabase::enlargeGrid
- * ----------------------------------------
- * This method increases the size of the dynamically allocated Sparse Grid while also
- * freeing memore associated with the old grid.  It increases the questions side
- * by a higher scaling factor since there tend to be more questions in the database than answers.
- */
-void QuestionsDatabase::enlargeGrid() {
-    SparseGrid<bool> *oldGrid = boolGrid;
-    boolGrid = new SparseGrid<bool>(oldGrid->numRows() * answersScalingFactor, oldGrid->numCols() * questionsScalingFactor);
-    for(int row = 0; row < oldGrid->numRows(); row++) {
-        for(int col = 0; col < oldGrid->numCols(); col++) {
-            (*boolGrid)[row][col] = (*oldGrid)[row][col];
+ * Function: QuestionsDatabase::readSnapshot
+ * -----------------------------------------
+ * Opens a snapshot written by writeSnapshot.  The snapshot is mapped into memory, so the only work left
+ * is to copy the names into the maps and the columns into the incidence matrix, which is sized exactly
+ * once.  The answers' lists of questions are rebuilt from each column.  The answers' sorted order is read,
+ * the answers are ranked alphabetically, and the opening tree is read if the snapshot has one.  With a memory budget, only the columns
+ * that stay in memory are kept, and the rest are read from the snapshot as they are needed.  Returns false if
+ * the file could not be opened, and throws an error if it is not a valid snapshot.
+ */
+bool QuestionsDatabase::readSnapshot(const string& filename) {
+    INSTRUMENT_TIMER("read_snapshot");
+    cout << "Reading in Snapshot..." << endl << endl;
+    SnapshotReader reader;
+    if(!reader.open(filename)) return false;
+    const char* bytes;
+    uint64_t length;
+    if(!reader.section(COLUMNS_SECTION, bytes, length)) error("Snapshot is missing the incidence matrix");
+    if(length < 2 * sizeof(uint64_t)) error("Snapshot incidence matrix is truncated");
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(bytes);
+    uint64_t numAnswers = words[0], numQuestions = words[1];
+    if(numAnswers > uint64_t(INT32_MAX) || numQuestions > length) error("Snapshot incidence matrix is invalid");
+    sizeDatabase(numAnswers, numQuestions);
+    readNames(reader, ANSWER_NAMES_SECTION, [this](string_view name) { addAnswer(name); });
+    readNames(reader, QUESTION_NAMES_SECTION, [this](string_view question) { addQuestion(question); });
+    if(uint64_t(answerNames.size()) != numAnswers || uint64_t(questionNames.size()) != numQuestions)
+        error("Snapshot names do not match the incidence matrix");
+    if(memoryBudget > 0) {
+        readOffloadedColumns(filename, reader.offsetOf(bytes), bytes, length);
+    } else {
+        readColumns(bytes, length);
+        for(int col = 0; col < questionNames.size(); col++) {
+            incidence.column(col).forEachSet([this, col](int row) { answerQuestions[row]->add(col); });
+            checksumColumn(incidence.column(col));
         }
+        countSupport();
     }
-    delete oldGrid;
+    if(!reader.section(ANSWER_INDEX_SECTION, bytes, length)) error("Snapshot is missing the answer index");
+    readAnswerIndex(bytes, length);
+    rankAnswers();
+    if(reader.section(OPENING_TREE_SECTION, bytes, length)) readOpeningTree(bytes, length);
+    readMergedQuestions(reader);
+    checksumNames();
+    return true;
 }
 
 /**
- * Function: QuestionsDatabase::readFile
- * This will read in the file and will store all of the appropriate information.  It
- * will first isolate the answer and will store it in the divideMap if it is not already contained
- * in it.  It will read in the question and will also store the question in its own separate map
- * if it is new.  It will then go to the appropriate location on the sparse grid, and will put
- * a true for the index associate with that particular quesiton and answer.  By doing this, it allows
- * for O(1) look up for a quesiton and answer.
- */
-void QuestionsDatabase::readFile(ifstream& input) {
-    cout << "Reading in File..." << endl << endl;
-    while(input) {
-        char curr = input.get();
-        if(curr == '<') {
-            string name;
-            readKey(input, name, curr);
-            if(!probabilities.containsKey(name)) {
-                answerInfo answer = {0, probabilities.size()};
-                probabilities.put(name, answer);
-                if(boolGrid->numRows() < probabilities.size()) enlargeGrid();
+ * Function: QuestionsDatabase::locateColumns
+ * ------------------------------------------
+ * Finds where every column of a section written by writeSnapshot starts, as a number of words from the start of
+ * the section, checking that every column fits in the section and that the answers of every array are in
+ * increasing order and exist.
+ */
+vector<uint64_t> QuestionsDatabase::locateColumns(const char* bytes, uint64_t length) {
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(bytes);
+    uint64_t numWords = length / sizeof(uint64_t);
+    uint64_t wordsPerColumn = BitVector::wordsFor(answerNames.size());
+    vector<uint64_t> starts(questionNames.size());
+    uint64_t next = 2;
+    for(int col = 0; col < questionNames.size(); col++) {
+        if(numWords - next < 2) error("Snapshot incidence matrix is truncated");
+        uint64_t kind = words[next], count = words[next + 1];
+        if(kind > 1 || (kind == 1 && count != wordsPerColumn) || (kind == 0 && count > uint64_t(answerNames.size())))
+            error("Snapshot incidence matrix is invalid");
+        if(numWords - next < ColumnCache::encodedWords(kind, count)) error("Snapshot incidence matrix is truncated");
+        if(kind == 0) {
+            const uint32_t* rows = reinterpret_cast<const uint32_t*>(words + next + 2);
+            for(uint64_t i = 0; i < count; i++) {
+                if(rows[i] >= uint32_t(answerNames.size()) || (i > 0 && rows[i] <= rows[i - 1]))
+                    error("Snapshot incidence matrix is invalid");
             }
-            while(curr != '<')
-                curr = input.get();
-            string question;
-            readKey(input, question, curr);
-            question = toUpperCase(question);
-            removeHeaders(question);
-            if(!questions.containsKey(question)) questions[question] = questions.size();
-            if(questions.size() > boolGrid->numCols()) enlargeGrid();
-            (*boolGrid)[probabilities[name].index][questions[question]] = true;
         }
+        starts[col] = next;
+        next += ColumnCache::encodedWords(kind, count);
+    }
+    return starts;
+}
+
+/**
+ * Function: QuestionsDatabase::readColumns
+ * ----------------------------------------
+ * Reads the incidence matrix from a section written by writeSnapshot.
+ */
+void QuestionsDatabase::readColumns(const char* bytes, uint64_t length) {
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(bytes);
+    vector<uint64_t> starts = locateColumns(bytes, length);
+    for(int col = 0; col < questionNames.size(); col++) {
+        const uint64_t* column = words + starts[col];
+        if(column[0] == 1) incidence.loadColumn(col, column + 2);
+        else incidence.loadRows(col, reinterpret_cast<const uint32_t*>(column + 2), column[1]);
+    }
+}
+
+/**
+ * Function: QuestionsDatabase::readOffloadedColumns
+ * -------------------------------------------------
+ * Reads the incidence matrix from a section written by writeSnapshot under the memory budget.  Each column is
+ * unpacked once to count its answers and fill in the answers' lists of questions, and then dropped.  Once the
+ * columns that stay in memory are chosen (see chooseResident), only those are unpacked again and kept, and the
+ * others are read from the snapshot file through the column cache.  The section starts sectionOffset bytes
+ * into the file.
+ */
+void QuestionsDatabase::readOffloadedColumns(const string& filename, uint64_t sectionOffset, const char* bytes,
+                                             uint64_t length) {
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(bytes);
+    vector<uint64_t> starts = locateColumns(bytes, length);
+    vector<size_t> columnBytes(questionNames.size());
+    questionSupport.clear();
+    for(int col = 0; col < questionNames.size(); col++) {
+        shared_ptr<HybridColumn> column = ColumnCache::decode(words + starts[col], answerNames.size());
+        column->forEachSet([this, col](int row) { answerQuestions[row]->add(col); });
+        checksumColumn(*column);
+        questionSupport.add(column->count());
+        columnBytes[col] = column->memoryUsage();
+    }
+    size_t residentBytes;
+    BitVector resident = chooseResident(columnBytes, residentBytes);
+    printResidency(resident.count(), questionNames.size(), residentBytes, questionListMemoryUsage(), memoryBudget);
+    columnCache = make_shared<ColumnCache>(columnBudget() - min(residentBytes, columnBudget()));
+    if(!columnCache->open(filename)) error("Could not open " + filename + " to read columns from");
+    offloadedRows = answerNames.size();
+    columnOffsets.assign(questionNames.size(), 0);
+    for(int col = 0; col < questionNames.size(); col++) {
+        if(resident.test(col)) {
+            incidence.restore(col, ColumnCache::decode(words + starts[col], answerNames.size()));
+        } else {
+            columnOffsets[col] = sectionOffset + starts[col] * sizeof(uint64_t);
+            incidence.offload(col);
+            offloaded.set(col);
+        }
+    }
+}
+
+/**
+ * Function: QuestionsDatabase::readAnswerIndex
+ * --------------------------------------------
+ * Reads the answers' sorted order written by writeSnapshot, checking that it holds every answer once, in order.
+ */
+void QuestionsDatabase::readAnswerIndex(const char* bytes, uint64_t length) {
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(bytes);
+    if(length < sizeof(uint64_t) || words[0] != uint64_t(answerNames.size()))
+        error("Snapshot answer index is invalid");
+    if(length - sizeof(uint64_t) < words[0] * sizeof(uint32_t)) error("Snapshot answer index is truncated");
+    if(!answerIndex.assign(answerNames, reinterpret_cast<const uint32_t*>(words + 1), answerNames.size()))
+        error("Snapshot answer index is invalid");
+}
+
+/**
+ * Function: QuestionsDatabase::readMergedQuestions
+ * ------------------------------------------------
+ * Reads the merged labels written by writeSnapshot, checking that each was merged into a real question.  Every
+ * snapshot of this version has them, even if there are none, since a snapshot without them would forget which
+ * question each merged label stands for.
+ */
+void QuestionsDatabase::readMergedQuestions(const SnapshotReader& reader) {
+    const char* bytes;
+    uint64_t length;
+    if(!reader.section(MERGED_INTO_SECTION, bytes, length)) error("Snapshot is missing the merged questions");
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(bytes);
+    if(length < sizeof(uint64_t) || length - sizeof(uint64_t) < words[0] * sizeof(int32_t))
+        error("Snapshot merged questions are truncated");
+    const int32_t* into = reinterpret_cast<const int32_t*>(words + 1);
+    readNames(reader, MERGED_NAMES_SECTION, [this](string_view name) { mergedNames.intern(name); });
+    if(uint64_t(mergedNames.size()) != words[0]) error("Snapshot merged questions are invalid");
+    for(uint64_t label = 0; label < words[0]; label++) {
+        if(into[label] < 0 || into[label] >= questionNames.size()) error("Snapshot merged questions are invalid");
+        mergedInto.add(into[label]);
+    }
+}
+
+/**
+ * Function: QuestionsDatabase::readOpeningTree
+ * --------------------------------------------
+ * Reads an opening tree written by writeSnapshot, checking that every node names a real question.
+ */
+void QuestionsDatabase::readOpeningTree(const char* bytes, uint64_t length) {
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(bytes);
+    if(length < 5 * sizeof(uint64_t) || words[0] > uint64_t(DecisionTree::maxDepth))
+        error("Snapshot opening tree is invalid");
+    double noiseRate;
+    memcpy(&noiseRate, &words[2], sizeof(noiseRate));
+    DecisionTree tree(words[0], words[1], noiseRate, words[3], words[4]);
+    if(length < 5 * sizeof(uint64_t) + tree.numNodes() * sizeof(int32_t))
+        error("Snapshot opening tree is truncated");
+    memcpy(tree.data(), words + 5, tree.numNodes() * sizeof(int32_t));
+    for(int node = 0; node < tree.numNodes(); node++) {
+        if(tree.question(node) < -1 || tree.question(node) >= questionNames.size())
+            error("Snapshot opening tree names a question that does not exist");
     }
+    openingTree = tree;
 }
@@ -1,47 +1,110 @@
+#ifndef _questionsdatabase_
+#define _questionsdatabase_
+
 #include <iostream>
+#include <memory>
 #include <string>
 #include "fstream"
 #include "console.h"
-#include "queue.h"
-#include "sparsegrid.h"
-#include "hashmap.h"
 #include "set.h"
-#include "dividemap.h"
+#include "vector.h"
+#include "interntable.h"
+#include "answerindex.h"
+#include "bitmatrix.h"
+#include "bitvector.h"
+#include "hybridcolumn.h"
+#include "columncache.h"
+#include "threadpool.h"
+#include "decisiontree.h"
 
 using namespace std;
 
+class SnapshotReader;
+
 class QuestionsDatabase {
 public:
 
     QuestionsDatabase();
     ~QuestionsDatabase();
 
-    void readFile(ifstream& input);
-    void showAnswerKey();
-    bool getNextQuestion(string& question, const int numQuestion);
-    void updateDatabase(bool response, const string& question, int numQuestions);
-    void removeIncorrectGuess(const string& guess);
-    bool contains(const string& response);
-    void findDifference(const string& response);
+    bool readFile(const string& filename);
+    bool readSnapshot(const string& filename);
+    bool writeSnapshot(const string& filename);
+    void showAnswerKey(const string& prefix = "") const;
+    bool contains(const string& response) const;
+    int findAnswer(const string& response) const;
+    Vector<string> suggestAnswers(const string& response, int maxSuggestions) const;
+    void setNumThreads(int numThreads);
+    void setOpeningTree(const DecisionTree& tree);
+    void setQuestionBounds(int minSupport, double maxShare);
+    void setMemoryBudget(size_t bytes);
+    void startNextEpoch();
+    void appendAnswer(const string& answer);
+    void appendEdge(const string& answer, const string& question);
+
+    int numAnswers() const;
+    int numQuestions() const;
+    const InternTable& getAnswerNames() const;
+    const InternTable& getQuestionNames() const;
+    bool fits(int answer, int question) const;
+    const Vector<int>& questionsOf(int answer) const;
+    shared_ptr<const HybridColumn> getQuestionColumn(int question) const;
+    const BitVector& getOffloadedQuestions() const;
+    uint64_t offloadedFingerprint() const;
+    const Vector<int>& getQuestionSupport() const;
+    const Vector<int>& getAnswerRanks() const;
+    ThreadPool* getSearchPool() const;
+    const DecisionTree& getOpeningTree() const;
+    int getEpoch() const;
+    uint64_t fingerprint() const;
+    size_t matrixMemoryUsage() const;
+    size_t questionListMemoryUsage() const;
+    ColumnCache::Stats columnCacheStats() const;
 
 private:
-    struct questionInfo {
-        string question;
-        int index;
-        bool response; // what the user answered for that question
-    };
-    struct answerInfo {
-        int prob; // contains the number of similarities with the responses that the user enters
-        int index;
-    };
-
-    SparseGrid<bool>* boolGrid;
-    DivideMap<answerInfo> probabilities;
-    HashMap<string, int> questions; // question to index
-    Queue<questionInfo> questionsAsked;
-    void enlargeGrid();
-    void removeHeaders(string& question);
-    void readKey(ifstream& input, string& str, char& curr);
-    int selectBestQuestion(Set<int>& potentials);
-    string bestGuess();
+    BitMatrix incidence; // column per question, bit per answer
+    InternTable answerNames; // answer to index and back
+    AnswerIndex answerIndex; // the answers sorted by name, ignoring case, for looking up what the user typed
+    InternTable questionNames; // question to index and back
+    InternTable mergedNames; // labels of questions that were merged into a duplicate at load time
+    Vector<int> mergedInto; // merged label index to the question it was merged into
+    Vector<shared_ptr<Vector<int> > > answerQuestions; // answer index to the indices of the questions it fits
+    Vector<int> questionSupport; // question index to the number of answers that fit it
+    Vector<int> answerRanks; // answer index to its position among the answers in alphabetical order
+    vector<int> rankedAnswers; // the answers in alphabetical order, so the inverse of answerRanks
+    DecisionTree openingTree; // the questions sessions ask in their opening moves, planned ahead of time
+    int epoch; // how many times answers or questions have been appended since the database was loaded
+    uint64_t contentChecksum; // of the columns and names loaded and everything appended since, see fingerprint
+    int minQuestionSupport; // questions that fewer answers fit are dropped at load time
+    double maxQuestionShare; // questions that more than this share of the answers fit are dropped at load time
+    shared_ptr<ThreadPool> searchPool; // workers for the question search, NULL when searching on one thread
+    size_t memoryBudget; // the bytes the columns may take, or 0 to keep every column in memory
+    shared_ptr<ColumnCache> columnCache; // where the offloaded columns are read from, NULL if there are none
+    BitVector offloaded; // bit per question whose column is on disk rather than in the matrix
+    vector<uint64_t> columnOffsets; // question index to where its column is in the column cache's file
+    int offloadedRows; // the number of answers when the columns were offloaded
+    void sizeDatabase(int numAnswers, int numQuestions);
+    void reserveNames(const vector<string_view>& answers, const vector<string_view>& categories);
+    void addAnswer(string_view name);
+    void addQuestion(string_view question);
+    void addEdge(int row, int col);
+    int resolveQuestion(const string& question) const;
+    void checksumColumn(const HybridColumn& column);
+    void checksumNames();
+    Vector<int>& writableQuestionsOf(int answer);
+    void countSupport();
+    void rankAnswers();
+    void pruneQuestions();
+    size_t columnBudget() const;
+    BitVector chooseResident(const vector<size_t>& columnBytes, size_t& residentBytes) const;
+    void offloadColumns();
+    void restoreColumn(int question);
+    vector<uint64_t> locateColumns(const char* bytes, uint64_t length);
+    void readColumns(const char* bytes, uint64_t length);
+    void readOffloadedColumns(const string& filename, uint64_t sectionOffset, const char* bytes, uint64_t length);
+    void readAnswerIndex(const char* bytes, uint64_t length);
+    void readOpeningTree(const char* bytes, uint64_t length);
+    void readMergedQuestions(const SnapshotReader& reader);
 };
+
+#endif
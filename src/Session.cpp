@@ -0,0 +1,649 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * Session
+ * --------------
+ * The session is responsible for determining the best questions to ask so that the response to the
+ * question evenly divides the possibilities, so that the computer can figure out what the word is that
+ * the user is thinking of.  It also updates the probabilites for each answer after each response and
+ * refines the list by removing outliers that are no longer possibilities.  All of this is kept in the
+ * session, so the database it reads from is never changed.
+ * Every candidate has a weight: with EVEN_SPLIT it is always one, and with INFORMATION_GAIN it is the
+ * candidate's likelihood under the noise model relative to a candidate that matched every response.
+ * The total weight of the candidates that fit each question is kept up to date as candidates are
+ * reweighted or dropped, so that finding the next question is a single pass over the questions.
+ * The candidates are a bit per answer, and each answer's counts of matching and mismatching responses
+ * are kept in flat arrays indexed by answer, so the passes over the candidates in updateDatabase and
+ * bestGuess go through them 64 answers at a time, without branching on any one answer.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include "Session.h"
+#include "error.h"
+#include "instrument.h"
+using namespace std;
+
+/* Constants */
+static const int maxNumQuestions = 20;
+static const string SENTINEL = "EMPTY_SET";
+static const double thresholdValue = 0.75;
+static const int minNumPossibilities = 3;
+static const int minParallelQuestions = 4096;
+static const double defaultNoiseRate = 0.05;
+static const int defaultMaxMismatches = 2;
+static const double guessConfidence = 0.9;
+static const double compactFraction = 0.5;
+static const double offloadedPenalty = 0.02;
+static const int cancelCheckQuestions = 4096;
+static const int weightBits = 30;
+
+/**
+ * Function: Session::Session
+ * --------------------------
+ * Starts a new game that picks its questions with the strategy, using the default noise model.
+ */
+Session::Session(const QuestionsDatabase& database, QuestionStrategy strategy) :
+    Session(database, strategy, defaultNoiseRate, defaultMaxMismatches) {
+}
+
+/**
+ * Function: Session::Session
+ * --------------------------
+ * Starts a new game in which every answer in the database is a candidate and no questions have been asked.
+ * The noise rate is the chance that the user answers any one question wrongly, and a candidate is dropped once
+ * more than maxMismatches responses have not matched it; both are only used by INFORMATION_GAIN.
+ * Since every answer is a candidate with a weight of one, the weight of the candidates that fit each question is
+ * simply the number of answers that fit it, which the database has already counted.
+ * Every weight is rounded to a whole number of 2^-30ths, so that any sum of them (of fewer than 2^23 answers) is
+ * exact, and the weights come out the same whatever order the candidates were reweighted or dropped in.
+ */
+Session::Session(const QuestionsDatabase& database, QuestionStrategy strategy, double noiseRate, int maxMismatches) :
+    database(&database),
+    matches(database.numAnswers(), 0),
+    mismatches(database.numAnswers(), 0),
+    candidates(database.numAnswers()),
+    numCandidates(database.numAnswers()),
+    questionAsked(database.numQuestions()),
+    fitting(database.numAnswers()),
+    totalWeight(database.numAnswers()),
+    strategy(strategy),
+    noiseRate(noiseRate),
+    maxMismatches(maxMismatches),
+    treeNode(-1),
+    compacted(false),
+    compactedSize(database.numAnswers()),
+    log(strategy, noiseRate, maxMismatches, database.numAnswers(), database.numQuestions(), database.fingerprint()) {
+    if(noiseRate <= 0.0 || noiseRate >= 0.5) error("Noise rate must be between 0 and 0.5");
+    if(maxMismatches < 0) error("Maximum number of mismatches cannot be negative");
+    candidates.setAll();
+    for(int mismatches = 0; mismatches <= maxMismatches; mismatches++) {
+        double units = round(ldexp(pow(noiseRate / (1.0 - noiseRate), mismatches), weightBits));
+        mismatchWeights.add(ldexp(max(units, 1.0), -weightBits));
+    }
+    for(int support: database.getQuestionSupport())
+        yesWeights.add(support);
+    if(database.getOpeningTree().plannedFor(strategy, noiseRate, maxMismatches, database.offloadedFingerprint()))
+        treeNode = 0;
+}
+
+/**
+ * Function: Session::Session
+ * --------------------------
+ * Starts a new game against an epoch of a LiveDatabase, which the session keeps alive until it ends.  Appends
+ * that are published while the game is played do not change anything the session sees.
+ */
+Session::Session(shared_ptr<const QuestionsDatabase> epoch, QuestionStrategy strategy) :
+    Session(*epoch, strategy) {
+    this->epoch = epoch;
+}
+
+/**
+ * Function: Session::Session
+ * --------------------------
+ * Restores the game recorded in the log, which must have been played against this database, with the rules it
+ * was played by.  See Session::restore.
+ */
+Session::Session(const QuestionsDatabase& database, const SessionLog& log) :
+    Session(database, QuestionStrategy(log.getStrategy()), log.getNoiseRate(), log.getMaxMismatches()) {
+    restore(log);
+}
+
+/**
+ * Function: Session::Session
+ * --------------------------
+ * Restores the game recorded in the log against an epoch of a LiveDatabase, which the session keeps alive until it
+ * ends.  The epoch must hold the same database the game was played against.
+ */
+Session::Session(shared_ptr<const QuestionsDatabase> epoch, const SessionLog& log) :
+    Session(*epoch, log) {
+    this->epoch = epoch;
+}
+
+/**
+ * Function: Session::planOpenings
+ * -------------------------------
+ * Plans the opening tree of the given depth for sessions that use the strategy with the default noise model.
+ * Every node is planned by playing a session down to it and asking it for its next question, so following the
+ * tree always asks exactly what searching would have asked.
+ */
+DecisionTree Session::planOpenings(const QuestionsDatabase& database, int depth, QuestionStrategy strategy) {
+    Session root(database, strategy);
+    root.treeNode = -1;
+    DecisionTree tree(depth, strategy, root.noiseRate, root.maxMismatches, database.offloadedFingerprint());
+    if(!tree.isEmpty()) planNode(tree, root, 0, 1);
+    return tree;
+}
+
+/**
+ * Function: Session::planNode
+ * ---------------------------
+ * Fills in the question that the session asks at the node, and then plans both of the node's children from a
+ * copy of the session that was given each response.  Branches where the session guesses are left empty.
+ */
+void Session::planNode(DecisionTree& tree, Session& session, int node, int numQuestion) {
+    string question;
+    if(session.getNextQuestion(question, numQuestion) || question == SENTINEL) return;
+    tree.setQuestion(node, session.database->getQuestionNames().find(question));
+    int yesNode = tree.child(node, true);
+    if(yesNode == -1) return;
+    Session yesSession = session;
+    yesSession.updateDatabase(true, question, numQuestion);
+    planNode(tree, yesSession, yesNode, numQuestion + 1);
+    session.updateDatabase(false, question, numQuestion);
+    planNode(tree, session, tree.child(node, false), numQuestion + 1);
+}
+
+/**
+ * Function: Session::getStrategy
+ * ------------------------------
+ * Returns the strategy the session picks its questions with.
+ */
+QuestionStrategy Session::getStrategy() const {
+    return strategy;
+}
+
+/**
+ * Function: Session::getNoiseRate
+ * -------------------------------
+ * Returns the chance of a wrong response that the session assumes.
+ */
+double Session::getNoiseRate() const {
+    return noiseRate;
+}
+
+/**
+ * Function: Session::getMaxMismatches
+ * -----------------------------------
+ * Returns how many mismatches a candidate can have before the session drops it.
+ */
+int Session::getMaxMismatches() const {
+    return maxMismatches;
+}
+
+/**
+ * Function: Session::getLog
+ * -------------------------
+ * Returns every response the session has been given so far, which a new session can be restored from.
+ */
+const SessionLog& Session::getLog() const {
+    return log;
+}
+
+/**
+ * Function: Session::memoryUsage
+ * ------------------------------
+ * Returns roughly how many bytes this session has allocated on top of the shared database.
+ */
+size_t Session::memoryUsage() const {
+    return sizeof(Session) + (matches.capacity() + mismatches.capacity()) * sizeof(int32_t) +
+           (candidates.numWords() + questionAsked.numWords() + fitting.numWords()) * sizeof(uint64_t) +
+           yesWeights.size() * sizeof(double) + liveQuestions.capacity() * sizeof(int) +
+           questionsAsked.size() * sizeof(questionInfo) + log.memoryUsage();
+}
+
+/**
+ * Function: Session::getYesQuestions
+ * ----------------------------------
+ * Returns the questions the user has answered yes to so far, in the order they were asked.  If the user was
+ * thinking of a word the database does not know, these are the questions it is known to fit.
+ */
+Vector<string> Session::getYesQuestions() const {
+    Vector<string> questions;
+    Queue<questionInfo> remaining = questionsAsked;
+    while(!remaining.isEmpty()) {
+        questionInfo question = remaining.dequeue();
+        if(question.response) questions += string(database->getQuestionNames().name(question.index));
+    }
+    return questions;
+}
+
+/**
+ * Function: Session::removeIncorrectGuess
+ * ---------------------------------------
+ * Eliminates the incorrect guess from the subset of answers which the program is still considering.
+ */
+void Session::removeIncorrectGuess(const string& guess) {
+    treeNode = -1;
+    int answer = database->getAnswerNames().find(guess);
+    if(answer == -1) return;
+    log.addRejectedGuess(answer);
+    eliminateCandidate(answer);
+}
+
+/**
+ * Function: Session::eliminateCandidate
+ * -------------------------------------
+ * Removes the answer from the candidates.  Since the answer is no longer a candidate, every question that it
+ * fits loses its weight.
+ */
+void Session::eliminateCandidate(int answer) {
+    if(!candidates.test(answer)) return;
+    candidates.reset(answer);
+    numCandidates--;
+    INSTRUMENT_COUNT("candidates_eliminated", database->questionsOf(answer).size());
+    double weight = mismatchWeights[mismatches[answer]];
+    totalWeight -= weight;
+    for(int question: database->questionsOf(answer))
+        yesWeights[question] -= weight;
+}
+
+/**
+ * Function: Session::addMismatch
+ * ------------------------------
+ * Records that a response did not match the answer.  If that is more mismatches than are allowed, the answer
+ * is dropped, otherwise its weight shrinks and every question that it fits loses the difference.
+ */
+void Session::addMismatch(int answer) {
+    if(mismatches[answer] == maxMismatches) {
+        eliminateCandidate(answer);
+        return;
+    }
+    INSTRUMENT_COUNT("candidates_reweighted", database->questionsOf(answer).size());
+    double lost = mismatchWeights[mismatches[answer]] - mismatchWeights[mismatches[answer] + 1];
+    mismatches[answer]++;
+    totalWeight -= lost;
+    for(int question: database->questionsOf(answer))
+        yesWeights[question] -= lost;
+}
+
+/**
+ * Function: Session::findDifference
+ * ---------------------------------
+ * This function is called whenever the program cannot figure out what the user was thinking of
+ * when the word is contained within the database.  It will iterate through the responses to
+ * the questions that the program asked, and will alert the user of the questions that they
+ * answered incorrectly for the solution.  If the user answered everything correctly, and the program
+ * still does not answer it correctly (due to bad dataset), it will prompt the user with a different
+ * statement.  The word is looked up with QuestionsDatabase::findAnswer, so its case does not matter.
+ */
+void Session::findDifference(const string& response) {
+    int counter = 0;
+    int answer = database->findAnswer(response);
+    if(answer == -1) error("Database does not contain answer");
+    while(!questionsAsked.isEmpty()) {
+        questionInfo question = questionsAsked.dequeue();
+        if(database->fits(answer, question.index) != question.response) {
+            cout << "You incorrectly answered " << database->getQuestionNames().name(question.index) << endl;
+            counter++;
+        }
+    }
+    if(counter == 0) cout << "I was about to get to that one.." << endl;
+}
+
+/**
+ * Function: Session::bestGuess
+ * ----------------------------
+ * This function is called when the computer is forced to make a guess as to what
+ * the word is that the user is thinking of.  It will return the index of the answer from the remaining subset
+ * with the highest probability of being correct, breaking ties in favor of the alphabetically first answer, or
+ * -1 if there are no answers left.  Every remaining answer has seen the same responses, so the one that matched
+ * the most of them is also the one with the fewest mismatches.
+ * Each answer is given a key that holds one more than its number of matches above its alphabetical rank (flipped,
+ * so that earlier names have larger keys), or 0 if it is not a candidate, and the answer with the largest key wins.
+ * The words of the candidates' bits that are empty are skipped.
+ */
+int Session::bestGuess() {
+    INSTRUMENT_TIMER("best_guess");
+    INSTRUMENT_COUNT("best_guess_candidates_scanned", numCandidates);
+    const Vector<int>& ranks = database->getAnswerRanks();
+    const uint64_t* words = candidates.data();
+    int numAnswers = candidates.size();
+    int mostProbable = -1;
+    uint64_t highestKey = 0;
+    for(int word = 0; word < candidates.numWords(); word++) {
+        if(words[word] == 0) continue;
+        int base = word * 64;
+        int end = min(base + 64, numAnswers);
+        for(int answer = base; answer < end; answer++) {
+            uint64_t isCandidate = (words[word] >> (answer - base)) & 1;
+            uint64_t key = ((uint64_t(matches[answer]) + 1) << 32 | uint32_t(~ranks[answer])) & (0 - isCandidate);
+            mostProbable = (key > highestKey)? answer: mostProbable;
+            highestKey = max(key, highestKey);
+        }
+    }
+    return mostProbable;
+}
+
+/**
+ * Function: Session::shouldGuess
+ * ------------------------------
+ * Decides whether the next turn should guess the answer rather than ask a question.  That is the case when only
+ * a couple of candidates are left, when it is the last question, or (with INFORMATION_GAIN) when the most likely
+ * candidate already holds most of the remaining weight.
+ */
+bool Session::shouldGuess(int numQuestion) {
+    if(numCandidates < minNumPossibilities || numQuestion == maxNumQuestions) return true;
+    if(strategy != INFORMATION_GAIN) return false;
+    int guess = bestGuess();
+    return mismatchWeights[mismatches[guess]] >= guessConfidence * totalWeight;
+}
+
+/**
+ * Function: Session::updateDatabase
+ * ---------------------------------
+ * This will update the session after the user answers the given question.  It will first add
+ * the information with the last question into the questionsAsked queue, which is called only when
+ * the user answers questions incorrectly.  This function will next mark the question as asked, so
+ * as to not ask the same question more than once.  It then goes through the remaining possible answers, and
+ * increases the matches of each answer that corresponds with the response from the user for the question that
+ * the computer asked.  With EVEN_SPLIT it keeps track of all of the answers whose matches fall below the threshold
+ * value, and will then eliminate them as outliers.  With INFORMATION_GAIN every answer that did not match the
+ * response gets a mismatch instead, and is only eliminated once it has too many.
+ * Most questions' columns are arrays of the answers that fit them, where looking up an answer is a binary
+ * search, so the answers in the column are first marked in the session's own bits and then looked up there.
+ * The pass works a word of 64 answers at a time: the answers that match are the candidates whose bit in the
+ * column equals the response, every answer's matches are increased by its bit of that, and the ones below the
+ * threshold are found in the same loop.  Only the words with candidates are visited.
+ */
+void Session::updateDatabase(bool response, const string& question, int numQuestions) {
+    INSTRUMENT_TIMER("update_database");
+    INSTRUMENT_COUNT("update_candidates_scanned", numCandidates);
+    int questionIndex = database->getQuestionNames().find(question);
+    if(questionIndex == -1) error("Database does not contain question");
+    questionInfo lastQuestion = {questionIndex, response};
+    questionsAsked.enqueue(lastQuestion);
+    questionAsked.set(questionIndex);
+    log.addResponse(questionIndex, response, numQuestions);
+    if(treeNode != -1) {
+        const DecisionTree& tree = database->getOpeningTree();
+        treeNode = (tree.question(treeNode) == questionIndex)? tree.child(treeNode, response): -1;
+    }
+    shared_ptr<const HybridColumn> column = database->getQuestionColumn(questionIndex);
+    const BitVector* fits = &fitting;
+    if(column->isDense()) fits = &column->denseBits();
+    else column->forEachSet([this](int answer) { fitting.set(answer); });
+    const uint64_t* words = candidates.data();
+    const uint64_t* fitWords = fits->data();
+    int numFitWords = fits->numWords();
+    int numAnswers = candidates.size();
+    uint64_t responseBits = response? ~uint64_t(0): 0;
+    double minMatches = thresholdValue * numQuestions;
+    Vector<int> toRemove;
+    Vector<int> mismatched;
+    for(int word = 0; word < candidates.numWords(); word++) {
+        if(words[word] == 0) continue;
+        uint64_t fitBits = (word < numFitWords)? fitWords[word]: 0;
+        uint64_t matched = ~(fitBits ^ responseBits) & words[word];
+        uint64_t belowThreshold = 0;
+        int base = word * 64;
+        int end = min(base + 64, numAnswers);
+        for(int answer = base; answer < end; answer++) {
+            matches[answer] += (matched >> (answer - base)) & 1;
+            belowThreshold |= uint64_t(matches[answer] < minMatches) << (answer - base);
+        }
+        uint64_t removed = (strategy == EVEN_SPLIT)? belowThreshold & words[word]: 0;
+        uint64_t missed = (strategy == INFORMATION_GAIN)? words[word] & ~matched: 0;
+        for(; removed != 0; removed &= removed - 1)
+            toRemove += base + __builtin_ctzll(removed);
+        for(; missed != 0; missed &= missed - 1)
+            mismatched += base + __builtin_ctzll(missed);
+    }
+    if(!column->isDense()) column->forEachSet([this](int answer) { fitting.reset(answer); });
+    for(int incorrectAnswer: toRemove)
+        eliminateCandidate(incorrectAnswer);
+    for(int answer: mismatched)
+        addMismatch(answer);
+}
+
+/**
+ * Function: Session::restore
+ * --------------------------
+ * Brings a new session up to the end of the game recorded in the log, in one pass instead of a call to
+ * updateDatabase per turn.  The columns of the logged questions are first gathered as lists of their non-empty
+ * words.  Then, for every word of 64 answers, the events are applied in order just as updateDatabase and
+ * removeIncorrectGuess would apply them to those answers, so the candidates and their counts of matches and
+ * mismatches come out exactly the same, while each answer's counts are only touched while they are in the cache.
+ * Only then are the weights summed, over the candidates that are left, rather than taken away from every question
+ * of every answer that is dropped along the way, which is where replaying the turns spends most of its time.
+ * The weights are whole numbers of 2^-30ths, so the sums are exact and come out the same as the ones the game kept
+ * up to date.  The opening tree is followed through the logged questions.
+ */
+void Session::restore(const SessionLog& saved) {
+    INSTRUMENT_TIMER("restore_session");
+    if(!saved.fits(database->numAnswers(), database->numQuestions(), database->fingerprint()))
+        error("Session log was recorded against a different database");
+    const std::vector<SessionLog::Event>& events = saved.getEvents();
+    int numEvents = events.size();
+    std::vector<std::vector<pair<int, uint64_t>>> columnWords(numEvents);
+    for(int event = 0; event < numEvents; event++) {
+        int index = events[event].index;
+        if(events[event].kind == SessionLog::REJECTED_GUESS) {
+            treeNode = -1;
+            continue;
+        }
+        bool response = (events[event].kind == SessionLog::ANSWERED_YES);
+        questionInfo question = {index, response};
+        questionsAsked.enqueue(question);
+        questionAsked.set(index);
+        if(treeNode != -1) {
+            const DecisionTree& tree = database->getOpeningTree();
+            treeNode = (tree.question(treeNode) == index)? tree.child(treeNode, response): -1;
+        }
+        database->getQuestionColumn(index)->forEachWord([&columnWords, event](int word, uint64_t bits) {
+            columnWords[event].push_back(make_pair(word, bits));
+        });
+    }
+
+    std::vector<uint64_t> remaining(candidates.data(), candidates.data() + candidates.numWords());
+    std::vector<size_t> cursors(numEvents, 0);
+    int numAnswers = candidates.size();
+    for(int word = 0; word < int(remaining.size()); word++) {
+        uint64_t alive = remaining[word];
+        int base = word * 64;
+        int end = min(base + 64, numAnswers);
+        for(int event = 0; event < numEvents; event++) {
+            const SessionLog::Event& logged = events[event];
+            if(logged.kind == SessionLog::REJECTED_GUESS) {
+                if(logged.index / 64 == word) alive &= ~(uint64_t(1) << (logged.index % 64));
+                continue;
+            }
+            uint64_t fitBits = 0;
+            size_t& cursor = cursors[event];
+            if(cursor < columnWords[event].size() && columnWords[event][cursor].first == word)
+                fitBits = columnWords[event][cursor++].second;
+            if(alive == 0) continue;
+            uint64_t responseBits = (logged.kind == SessionLog::ANSWERED_YES)? ~uint64_t(0): 0;
+            uint64_t matched = ~(fitBits ^ responseBits) & alive;
+            double minMatches = thresholdValue * logged.turn;
+            uint64_t belowThreshold = 0;
+            for(int answer = base; answer < end; answer++) {
+                matches[answer] += (matched >> (answer - base)) & 1;
+                belowThreshold |= uint64_t(matches[answer] < minMatches) << (answer - base);
+            }
+            if(strategy == EVEN_SPLIT) {
+                alive &= ~belowThreshold;
+                continue;
+            }
+            for(uint64_t missed = alive & ~matched; missed != 0; missed &= missed - 1) {
+                int answer = base + __builtin_ctzll(missed);
+                if(mismatches[answer] == maxMismatches) alive &= ~(uint64_t(1) << (answer - base));
+                else mismatches[answer]++;
+            }
+        }
+        remaining[word] = alive;
+    }
+
+    candidates.assign(remaining.data(), numAnswers);
+    numCandidates = candidates.count();
+    totalWeight = 0.0;
+    for(int question = 0; question < yesWeights.size(); question++)
+        yesWeights[question] = 0.0;
+    candidates.forEachSet([this](int answer) {
+        double weight = mismatchWeights[mismatches[answer]];
+        totalWeight += weight;
+        for(int question: database->questionsOf(answer))
+            yesWeights[question] += weight;
+    });
+    log = saved;
+}
+
+/**
+ * Function: Session::getNextQuestion
+ * ----------------------------------
+ * This deterministically finds the next question to ask the user.  While the game is still in the database's
+ * opening tree, the question is simply read from the tree.  Otherwise it will first check to see
+ * whether or not there are any remaining candidates.  If not it will return a sentinel
+ * string that alerts the main program that there are no possibilites left.  If there are few enough candidates left
+ * or the computer is on its last question, it will return the best guess for what the user is thinking of,
+ * and will return true to alert the main program that it is guessing the word and not a question.
+ * Otherwise, it will iteratively go through the questions that have not been asked, and finds the question that most
+ * evenly splits the weight of the remaining possible answers and sets it equal to the 'question' string passed in.
+ * The weight of the remaining answers that fit each question is already kept in yesWeights, so this is a single pass
+ * over the questions; once the candidates have narrowed, only over the questions that some candidate still fits (see
+ * compactQuestions).  When the database has search workers and enough questions to scan, the questions are split into
+ * ranges that are searched in parallel.  If no question splits the candidates at all, it guesses instead.
+ * With INFORMATION_GAIN the most even split is also the question with the most expected information: if w is the
+ * share of the weight that fits a question, the user says yes with probability p = noise + (1 - 2 * noise) * w, and
+ * the information gained is H(p) - H(noise), which is largest when p (and so w) is closest to one half.
+ * If 'cancelled' is given and gets set while the questions are being searched, the search stops early and
+ * returns false with an empty question; the session is left as it was, so it can be asked again.
+ */
+bool Session::getNextQuestion(string& question, const int numQuestion, const atomic<bool>* cancelled) {
+    INSTRUMENT_TIMER("next_question");
+    if(treeNode != -1) {
+        int planned = database->getOpeningTree().question(treeNode);
+        if(planned != -1) {
+            INSTRUMENT_COUNT("opening_tree_hits", 1);
+            question = database->getQuestionNames().name(planned);
+            return false;
+        }
+        treeNode = -1;
+    }
+    if(numCandidates == 0) {
+        question = SENTINEL;
+        return false;
+    }
+    if(shouldGuess(numQuestion)) {
+        question = database->getAnswerNames().name(bestGuess());
+        return true;
+    }
+    if(numCandidates <= compactedSize * compactFraction) compactQuestions();
+    int numQuestions = compacted? liveQuestions.size(): database->numQuestions();
+    INSTRUMENT_COUNT("search_questions_scanned", numQuestions);
+    INSTRUMENT_COUNT("search_candidates", numCandidates);
+    ThreadPool* searchPool = database->getSearchPool();
+    double cost = HUGE_VAL;
+    int best = -1;
+    if(searchPool == NULL || numQuestions < minParallelQuestions) {
+        best = selectBestQuestion(0, numQuestions, cost, cancelled);
+    } else {
+        Vector<int> localBests(searchPool->size() + 1, -1);
+        Vector<double> localCosts(searchPool->size() + 1, HUGE_VAL);
+        int numChunks = searchPool->parallelFor(0, numQuestions, [&](int chunk, int begin, int end) {
+            localBests[chunk] = selectBestQuestion(begin, end, localCosts[chunk], cancelled);
+        });
+        for(int chunk = 0; chunk < numChunks; chunk++) {
+            if(localBests[chunk] != -1 && localCosts[chunk] < cost) {
+                cost = localCosts[chunk];
+                best = localBests[chunk];
+            }
+        }
+    }
+    if(cancelled != NULL && *cancelled) {
+        question = "";
+        return false;
+    }
+    if(best == -1) {
+        question = database->getAnswerNames().name(bestGuess());
+        return true;
+    }
+    question = database->getQuestionNames().name(best);
+    return false;
+}
+
+/**
+ * Function: Session::compactQuestions
+ * -----------------------------------
+ * Re-packs the questions that the search has to look at into liveQuestions: the ones that have not been asked and
+ * that at least one remaining candidate fits.  Every other question has no weight on the yes side, so it can never
+ * split the candidates, and skipping it never changes which question is picked.  Candidates only ever leave, so a
+ * question that drops out never comes back, and each compaction just filters the questions the search scans now.
+ * This is tried each time the number of candidates halves, but the packed list is only kept when it is at most
+ * half as long as what the search scans now, since scanning through the list costs more per question than
+ * striding over all of them.  Answers keep their indices, so nothing else in the session (findDifference
+ * included) changes.
+ */
+void Session::compactQuestions() {
+    INSTRUMENT_TIMER("compact_questions");
+    compactedSize = numCandidates;
+    int numToScan = compacted? liveQuestions.size(): database->numQuestions();
+    auto isLive = [this](int question) {
+        return !questionAsked.test(question) && yesWeights[question] > 0.0;
+    };
+    int numLive = 0;
+    for(int position = 0; position < numToScan; position++)
+        numLive += isLive(compacted? liveQuestions[position]: position);
+    if(numLive > numToScan * compactFraction) return;
+    std::vector<int> packed;
+    packed.reserve(numLive);
+    for(int position = 0; position < numToScan; position++) {
+        int question = compacted? liveQuestions[position]: position;
+        if(isLive(question)) packed.push_back(question);
+    }
+    liveQuestions.swap(packed);
+    compacted = true;
+}
+
+/**
+ * Function: Session::selectBestQuestion
+ * -------------------------------------
+ * Finds the question in the range [begin, end) of the questions to scan that has not been asked and most evenly splits
+ * the weight of the remaining candidates.  The questions to scan are every question, or once they have been compacted,
+ * liveQuestions, which is in increasing order.  A question costs how far the share of the weight that fits it is from
+ * one half, plus a small penalty if its column has been offloaded to disk, so that a column in memory is asked instead
+ * of one that would have to be read when their splits are close.  The best question's cost is stored in 'cost' and its
+ * index is returned, or -1 if no question splits them at all.  A question only replaces the current best when it is
+ * strictly better, so ties go to the lowest index.  Since the chunks are combined in order with the same rule, the
+ * parallel search picks the same question as the serial one.  The scan checks 'cancelled' (if it is not NULL)
+ * every few thousand questions, and gives up with -1 once it is set.
+ */
+int Session::selectBestQuestion(int begin, int end, double& cost, const atomic<bool>* cancelled) {
+    int best = -1;
+    cost = HUGE_VAL;
+    double answerKeySize = totalWeight;
+    const BitVector& offloaded = database->getOffloadedQuestions();
+    auto consider = [&](int index) {
+        if(questionAsked.test(index)) return;
+        double distance = abs(0.5 - (yesWeights[index] / answerKeySize));
+        if(distance >= 0.5) return;
+        double questionCost = distance + offloadedPenalty * offloaded.test(index);
+        if(questionCost < cost) {
+            cost = questionCost;
+            best = index;
+        }
+    };
+    for(int block = begin; block < end; block += cancelCheckQuestions) {
+        if(cancelled != NULL && *cancelled) return -1;
+        int blockEnd = min(end, block + cancelCheckQuestions);
+        if(compacted) {
+            for(int position = block; position < blockEnd; position++)
+                consider(liveQuestions[position]);
+        } else {
+            for(int index = block; index < blockEnd; index++)
+                consider(index);
+        }
+    }
+    return best;
+}
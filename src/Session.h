@@ -0,0 +1,112 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * Session
+ * --------------
+ * A session is one game of 20 questions played against a QuestionsDatabase.  The database holds
+ * everything that never changes (the answers, the questions and which answers fit which questions)
+ * and can be shared by any number of sessions at once, while the session only holds what the
+ * current game has learned: how well each answer matches the responses so far, which answers are
+ * still candidates, how many candidates fit each question, and which questions have been asked.
+ *
+ * A session picks its questions with one of two strategies.  EVEN_SPLIT is the original one: every
+ * remaining candidate counts the same, and a candidate is dropped as soon as fewer than 75% of the
+ * responses so far match it.  INFORMATION_GAIN assumes that every response is wrong with a small
+ * probability (the noise rate), so a candidate's likelihood is multiplied by noise / (1 - noise) for
+ * every response that does not match it, and it is only dropped after more than a set number of
+ * mismatches.  Each question is then picked to give the most expected information about the answer.
+ *
+ * When the database keeps some of its columns on disk (see QuestionsDatabase::setMemoryBudget), a
+ * question whose column is in memory is preferred over one whose split is only slightly better.
+ *
+ * Every response is also written to the session's SessionLog.  A session can be restored from a log,
+ * against the same database, without replaying the turns one by one: see the constructor that takes one.
+ *
+ * If the database holds an opening tree that was planned with the session's rules, the session
+ * follows it for as long as it can, which skips the search for the first few questions.  It falls
+ * back to searching as soon as the tree ends or a wrong guess is removed.
+ */
+
+#ifndef _session_
+#define _session_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "queue.h"
+#include "vector.h"
+#include "bitvector.h"
+#include "decisiontree.h"
+#include "sessionlog.h"
+#include "QuestionsDatabase.h"
+
+using namespace std;
+
+/* The ways a session can pick its next question. */
+enum QuestionStrategy {
+    EVEN_SPLIT,
+    INFORMATION_GAIN
+};
+
+class Session {
+public:
+
+    Session(const QuestionsDatabase& database, QuestionStrategy strategy = INFORMATION_GAIN);
+    Session(const QuestionsDatabase& database, QuestionStrategy strategy, double noiseRate, int maxMismatches);
+    Session(shared_ptr<const QuestionsDatabase> epoch, QuestionStrategy strategy = INFORMATION_GAIN);
+    Session(const QuestionsDatabase& database, const SessionLog& log);
+    Session(shared_ptr<const QuestionsDatabase> epoch, const SessionLog& log);
+
+    static DecisionTree planOpenings(const QuestionsDatabase& database, int depth,
+                                     QuestionStrategy strategy = INFORMATION_GAIN);
+
+    bool getNextQuestion(string& question, const int numQuestion, const atomic<bool>* cancelled = NULL);
+    void updateDatabase(bool response, const string& question, int numQuestions);
+    void removeIncorrectGuess(const string& guess);
+    void findDifference(const string& response);
+    size_t memoryUsage() const;
+    Vector<string> getYesQuestions() const;
+    QuestionStrategy getStrategy() const;
+    double getNoiseRate() const;
+    int getMaxMismatches() const;
+    const SessionLog& getLog() const;
+
+private:
+    struct questionInfo {
+        int index;
+        bool response; // what the user answered for that question
+    };
+
+    const QuestionsDatabase* database; // shared, never changed by the session
+    shared_ptr<const QuestionsDatabase> epoch; // keeps the database alive when it came from a LiveDatabase
+    std::vector<int32_t> matches; // answer index to the number of responses that matched the answer
+    std::vector<int32_t> mismatches; // answer index to the number of responses that did not (INFORMATION_GAIN only)
+    BitVector candidates; // bit per answer that is still a candidate
+    int numCandidates; // the number of bits set in candidates
+    BitVector questionAsked; // bit per question that has already been asked
+    BitVector fitting; // bit per answer, only set for the answers that fit the question updateDatabase is applying
+    Vector<double> yesWeights; // question index to the total weight of the remaining candidates that fit it
+    double totalWeight; // the total weight of the remaining candidates
+    Vector<double> mismatchWeights; // number of mismatches to the weight of a candidate with that many
+    QuestionStrategy strategy;
+    double noiseRate; // the chance that any one response is wrong (INFORMATION_GAIN only)
+    int maxMismatches; // candidates with more mismatches than this are dropped (INFORMATION_GAIN only)
+    int treeNode; // where the game is in the database's opening tree, or -1 once it has left it
+    bool compacted; // whether the search only scans liveQuestions
+    std::vector<int> liveQuestions; // questions some candidate fits, in increasing order, as of the last compaction
+    int compactedSize; // the number of candidates when compaction was last tried (all of them before the first)
+    Queue<questionInfo> questionsAsked;
+    SessionLog log; // every response so far, to restore the session from
+    int selectBestQuestion(int begin, int end, double& cost, const atomic<bool>* cancelled);
+    void compactQuestions();
+    void restore(const SessionLog& saved);
+    void eliminateCandidate(int answer);
+    void addMismatch(int answer);
+    int bestGuess();
+    bool shouldGuess(int numQuestion);
+    static void planNode(DecisionTree& tree, Session& session, int node, int numQuestion);
+};
+
+#endif
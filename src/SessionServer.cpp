@@ -0,0 +1,270 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * SessionServer
+ * --------------
+ * The session server reads commands from a stream, one per line, and plays the games that they
+ * describe against a single shared database.  See SessionServer.h for the commands it understands.
+ */
+
+#include <sstream>
+#include "SessionServer.h"
+#include "strlib.h"
+#include "instrument.h"
+using namespace std;
+
+/* Constants */
+static const int maxNumQuestions = 20;
+static const string SENTINEL = "EMPTY_SET";
+static const string hexDigits = "0123456789abcdef";
+
+/**
+ * Function: SessionServer::SessionServer
+ * --------------------------------------
+ * Creates a server with no games that plays against the live database.  The live database must
+ * stay around for as long as the server is in use.
+ */
+SessionServer::SessionServer(LiveDatabase& live) : live(&live), nextId(1) {
+}
+
+/**
+ * Function: SessionServer::~SessionServer
+ * ---------------------------------------
+ * Ends every game that is still being played.
+ */
+SessionServer::~SessionServer() {
+    for(int id: games)
+        delete games[id].session;
+}
+
+/**
+ * Function: SessionServer::serve
+ * ------------------------------
+ * Reads commands until QUIT or the end of the input, writing one response line for each of them.
+ * Blank lines are skipped.  The output is flushed after every response so that the program on the
+ * other end can wait for it.
+ */
+void SessionServer::serve(istream& in, ostream& out) {
+    shared_ptr<const QuestionsDatabase> database = live->current();
+    out << "READY " << database->numAnswers() << " " << database->numQuestions() << endl;
+    string line;
+    while(getline(in, line)) {
+        line = trim(line);
+        if(line.empty()) continue;
+        if(toUpperCase(line) == "QUIT") {
+            out << "BYE" << endl;
+            break;
+        }
+        out << handle(line) << endl;
+    }
+}
+
+/**
+ * Function: SessionServer::handle
+ * -------------------------------
+ * Splits the line into a command, a game id and an argument, and carries out the command.
+ */
+string SessionServer::handle(const string& line) {
+    istringstream tokens(line);
+    string command;
+    tokens >> command;
+    command = toUpperCase(command);
+    if(command == "NEW") return startGame();
+    if(command == "STATS") return stats();
+    if(command == "METRICS") return metrics();
+    if(command == "RESTORE") {
+        string hex;
+        tokens >> hex;
+        return restoreGame(hex);
+    }
+    if(command == "TAIL") {
+        string filename;
+        getline(tokens >> ws, filename);
+        return tailFile(filename);
+    }
+    int id;
+    if(!(tokens >> id)) return "ERR expected a game id";
+    if(!games.containsKey(id)) return "ERR no game " + integerToString(id);
+    if(command == "NEXT") return nextQuestion(games[id]);
+    if(command == "ANSWER") {
+        string response;
+        tokens >> response;
+        return answerQuestion(games[id], toUpperCase(response));
+    }
+    if(command == "REJECT") return rejectGuess(games[id]);
+    if(command == "END") return endGame(id);
+    if(command == "SAVE") return saveGame(games[id]);
+    if(command == "LEARN") {
+        string answer;
+        getline(tokens >> ws, answer);
+        return learnAnswer(games[id], answer);
+    }
+    return "ERR unknown command " + command;
+}
+
+/**
+ * Function: SessionServer::startGame
+ * ----------------------------------
+ * Starts a new game and returns its id.
+ */
+string SessionServer::startGame() {
+    gameInfo game = {new Session(live->current()), 1, "", false};
+    int id = nextId++;
+    games[id] = game;
+    return "OK " + integerToString(id);
+}
+
+/**
+ * Function: SessionServer::nextQuestion
+ * -------------------------------------
+ * Asks the session for its next question or guess, just like one turn of the interactive game.  If
+ * the last question or guess has not been responded to, it is simply asked again.
+ */
+string SessionServer::nextQuestion(gameInfo& game) {
+    if(game.pending.empty()) {
+        if(game.turn > maxNumQuestions) return "STUMPED";
+        game.guessing = game.session->getNextQuestion(game.pending, game.turn);
+        if(game.pending == SENTINEL || game.pending.empty()) {
+            game.pending = "";
+            return "STUMPED";
+        }
+    }
+    return (game.guessing? "GUESS ": "QUESTION ") + game.pending;
+}
+
+/**
+ * Function: SessionServer::answerQuestion
+ * ---------------------------------------
+ * Updates the session with the response to the question that is waiting for one.
+ */
+string SessionServer::answerQuestion(gameInfo& game, const string& response) {
+    if(game.pending.empty() || game.guessing) return "ERR no question to answer";
+    if(response != "YES" && response != "NO") return "ERR expected YES or NO";
+    game.session->updateDatabase(response == "YES", game.pending, game.turn);
+    game.pending = "";
+    game.turn++;
+    return "OK";
+}
+
+/**
+ * Function: SessionServer::rejectGuess
+ * ------------------------------------
+ * Tells the session that the guess that is waiting for a response was wrong.
+ */
+string SessionServer::rejectGuess(gameInfo& game) {
+    if(game.pending.empty() || !game.guessing) return "ERR no guess to reject";
+    game.session->removeIncorrectGuess(game.pending);
+    game.pending = "";
+    game.turn++;
+    return "OK";
+}
+
+/**
+ * Function: SessionServer::endGame
+ * --------------------------------
+ * Ends the game, whether or not it was won, and frees its session.
+ */
+string SessionServer::endGame(int id) {
+    delete games[id].session;
+    games.remove(id);
+    return "OK";
+}
+
+/**
+ * Function: SessionServer::saveGame
+ * ---------------------------------
+ * Returns the game's log, with every byte as two hexadecimal digits.
+ */
+string SessionServer::saveGame(gameInfo& game) {
+    string bytes = game.session->getLog().encode();
+    string hex;
+    for(unsigned char byte: bytes) {
+        hex += hexDigits[byte >> 4];
+        hex += hexDigits[byte & 15];
+    }
+    return "LOG " + hex;
+}
+
+/**
+ * Function: SessionServer::restoreGame
+ * ------------------------------------
+ * Starts a new game from a log that was saved with SAVE, on the current epoch, and returns its id.  The next
+ * turn is the one after the last response in the log.  The log must have been saved against a database with
+ * the same fingerprint (see QuestionsDatabase::fingerprint), on this server or on another one that loaded the
+ * same data, from the text file or a snapshot of it, and learned the same things since; any other log is
+ * refused, since its questions and answers may not mean the same things here.
+ */
+string SessionServer::restoreGame(const string& hex) {
+    if(hex.size() % 2 != 0) return "ERR expected a saved log";
+    string bytes;
+    for(size_t i = 0; i < hex.size(); i += 2) {
+        size_t high = hexDigits.find(tolower(hex[i])), low = hexDigits.find(tolower(hex[i + 1]));
+        if(high == string::npos || low == string::npos) return "ERR expected a saved log";
+        bytes += char(high << 4 | low);
+    }
+    SessionLog log;
+    if(!log.decode(bytes)) return "ERR expected a saved log";
+    shared_ptr<const QuestionsDatabase> database = live->current();
+    if(!log.fits(database->numAnswers(), database->numQuestions(), database->fingerprint()))
+        return "ERR the log was saved against a different database";
+    gameInfo game = {new Session(database, log), log.lastTurn() + 1, "", false};
+    int id = nextId++;
+    games[id] = game;
+    return "OK " + integerToString(id);
+}
+
+/**
+ * Function: SessionServer::learnAnswer
+ * ------------------------------------
+ * Adds a new answer that fits every question the game's responses said yes to, and publishes it.  Games that
+ * are already being played do not see it; every game started afterwards does.  An answer the current epoch
+ * already knows (looked up the way giveUp looks it up) is refused rather than given the game's questions.
+ */
+string SessionServer::learnAnswer(gameInfo& game, const string& answer) {
+    if(answer.empty()) return "ERR expected an answer";
+    if(live->current()->contains(answer)) return "ERR " + answer + " is already known";
+    live->stageAnswer(answer, game.session->getYesQuestions());
+    return "OK " + integerToString(live->publish());
+}
+
+/**
+ * Function: SessionServer::tailFile
+ * ---------------------------------
+ * Reads whatever has been appended to the TSV file since it was last tailed, and publishes it.
+ */
+string SessionServer::tailFile(const string& filename) {
+    if(filename.empty()) return "ERR expected a filename";
+    int numPairs = live->tail(filename);
+    if(numPairs == -1) return "ERR could not open " + filename;
+    return "OK " + integerToString(live->current()->getEpoch()) + " " + integerToString(numPairs);
+}
+
+/**
+ * Function: SessionServer::stats
+ * ------------------------------
+ * Returns the number of games being played, roughly how many bytes their sessions use in total, the epoch, and
+ * roughly how many bytes the current epoch's columns in memory and answers' lists of questions take.
+ */
+string SessionServer::stats() {
+    size_t bytes = 0;
+    for(int id: games)
+        bytes += games[id].session->memoryUsage();
+    shared_ptr<const QuestionsDatabase> database = live->current();
+    return "STATS " + integerToString(games.size()) + " " + to_string(bytes) + " " +
+           integerToString(database->getEpoch()) + " " +
+           to_string(database->matrixMemoryUsage() + database->questionListMemoryUsage());
+}
+
+/**
+ * Function: SessionServer::metrics
+ * --------------------------------
+ * Returns every instrumentation counter as name=count/sum on one line.  Unless the program was built with
+ * instrumentation there are no counters, and the line is just METRICS.
+ */
+string SessionServer::metrics() {
+    string line = "METRICS";
+    Instrument::forEach([&line](const string& name, uint64_t count, uint64_t sum) {
+        line += " " + name + "=" + to_string(count) + "/" + to_string(sum);
+    });
+    return line;
+}
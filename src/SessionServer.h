@@ -0,0 +1,75 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * SessionServer
+ * --------------
+ * The session server lets another program play any number of games at once against one loaded
+ * database by sending it lines of text.  Every game is a Session on the live database's current
+ * epoch, so each extra game only costs the session's own state.  The server reads one command per
+ * line and answers every command with exactly one line:
+ *
+ *     NEW                      -> OK <id>
+ *     NEXT <id>                -> QUESTION <category> | GUESS <answer> | STUMPED
+ *     ANSWER <id> YES|NO       -> OK              (answers the last QUESTION)
+ *     REJECT <id>              -> OK              (the last GUESS was wrong)
+ *     END <id>                 -> OK
+ *     SAVE <id>                -> LOG <hex>       (the game's SessionLog, as hexadecimal)
+ *     RESTORE <hex>            -> OK <id>         (a new game picked up from a saved log)
+ *     LEARN <id> <answer>      -> OK <epoch>      (adds a new answer with the questions answered yes)
+ *     TAIL <filename>          -> OK <epoch> <pairs read>
+ *     STATS                    -> STATS <sessions> <bytes> <epoch> <database bytes>
+ *     METRICS                  -> METRICS <name>=<count>/<sum> ...   (see instrument.h)
+ *     QUIT                     -> BYE
+ *
+ * A saved game can be restored by any server that has the same database loaded, so a game can move
+ * to another process.  A question or guess that was asked but not yet responded to is not saved;
+ * the restored game simply asks it again.
+ *
+ * Anything that cannot be done is answered with a line starting with ERR.
+ */
+
+#ifndef _sessionserver_
+#define _sessionserver_
+
+#include <iostream>
+#include <string>
+#include "map.h"
+#include "Session.h"
+#include "LiveDatabase.h"
+
+using namespace std;
+
+class SessionServer {
+public:
+
+    SessionServer(LiveDatabase& live);
+    ~SessionServer();
+
+    void serve(istream& in, ostream& out);
+
+private:
+    struct gameInfo {
+        Session* session;
+        int turn; // the number of the question that NEXT will ask
+        string pending; // the question or guess that is waiting for a response
+        bool guessing; // whether pending is a guess rather than a question
+    };
+
+    LiveDatabase* live;
+    Map<int, gameInfo> games;
+    int nextId;
+    string handle(const string& line);
+    string startGame();
+    string nextQuestion(gameInfo& game);
+    string answerQuestion(gameInfo& game, const string& response);
+    string rejectGuess(gameInfo& game);
+    string endGame(int id);
+    string saveGame(gameInfo& game);
+    string restoreGame(const string& hex);
+    string learnAnswer(gameInfo& game, const string& answer);
+    string tailFile(const string& filename);
+    string stats();
+    string metrics();
+};
+
+#endif
@@ -0,0 +1,221 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * Snapshot
+ * --------------
+ * Writes and reads the sectioned snapshot files.  The writer streams the sections to disk while
+ * it computes the checksum, then goes back and fills in the header.  The reader maps the file,
+ * checks the header and the checksum, and hands out pointers straight into the mapping.
+ */
+
+#include <cstring>
+#include "Snapshot.h"
+#include "error.h"
+using namespace std;
+
+/* Constants */
+static const char snapshotMagic[8] = {'Q', 'D', 'B', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t snapshotVersion = 2; // 1 did not keep the labels of merged questions
+static const uint64_t checksumSeed = 0xcbf29ce484222325ULL;
+static const uint64_t checksumPrime = 0x100000001b3ULL;
+
+/* One entry in the table of sections. */
+struct SnapshotSection {
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset; // from the start of the file
+    uint64_t length; // not counting the padding after the section
+};
+
+/* The fixed size block at the start of every snapshot. */
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t numSections;
+    uint64_t payloadLength; // every byte after the header
+    uint64_t checksum; // of the payload
+    SnapshotSection sections[SnapshotWriter::maxSections];
+};
+
+/* Mixes one 8 byte word into the checksum. */
+static inline uint64_t mixWord(uint64_t checksum, uint64_t word) {
+    return (checksum ^ word) * checksumPrime;
+}
+
+/* Returns the checksum of a payload whose length is a multiple of 8 bytes. */
+static uint64_t checksumOf(const char* bytes, uint64_t length) {
+    uint64_t checksum = checksumSeed;
+    for(uint64_t offset = 0; offset + 8 <= length; offset += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + offset, 8);
+        checksum = mixWord(checksum, word);
+    }
+    return checksum;
+}
+
+/**
+ * Function: SnapshotWriter::SnapshotWriter
+ * ----------------------------------------
+ * Creates a writer that does not have a file open yet.
+ */
+SnapshotWriter::SnapshotWriter() : checksum(checksumSeed), pendingWord(0), pendingBytes(0), position(0), numSections(0) {
+}
+
+/**
+ * Function: SnapshotWriter::open
+ * ------------------------------
+ * Opens the file for writing and leaves room for the header, which is written once every section is known.
+ * Returns false if the file could not be created.
+ */
+bool SnapshotWriter::open(const string& filename) {
+    output.open(filename, ios::binary | ios::trunc);
+    if(output.fail()) return false;
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    position = sizeof(header);
+    return !output.fail();
+}
+
+/**
+ * Function: SnapshotWriter::beginSection
+ * --------------------------------------
+ * Ends the section being written, if there is one, and starts a new one with the given id.
+ */
+void SnapshotWriter::beginSection(uint32_t id) {
+    if(numSections > 0) endSection();
+    if(numSections == maxSections) error("Too many sections in snapshot");
+    ids[numSections] = id;
+    offsets[numSections] = position;
+    lengths[numSections] = 0;
+    numSections++;
+}
+
+/**
+ * Function: SnapshotWriter::write
+ * -------------------------------
+ * Appends the bytes to the current section and folds them into the checksum.  Whole words are mixed in
+ * directly; leftover bytes wait in pendingWord until the word they belong to is complete.
+ */
+void SnapshotWriter::write(const void* bytes, size_t length) {
+    const char* curr = static_cast<const char*>(bytes);
+    output.write(curr, length);
+    position += length;
+    lengths[numSections - 1] += length;
+    size_t done = 0;
+    while(done < length && pendingBytes != 0) {
+        pendingWord |= uint64_t(static_cast<unsigned char>(curr[done++])) << (8 * pendingBytes);
+        if(++pendingBytes == 8) {
+            checksum = mixWord(checksum, pendingWord);
+            pendingWord = 0;
+            pendingBytes = 0;
+        }
+    }
+    for(; done + 8 <= length; done += 8) {
+        uint64_t word;
+        memcpy(&word, curr + done, 8);
+        checksum = mixWord(checksum, word);
+    }
+    for(; done < length; done++)
+        pendingWord |= uint64_t(static_cast<unsigned char>(curr[done])) << (8 * pendingBytes++);
+}
+
+/**
+ * Function: SnapshotWriter::writeWord
+ * -----------------------------------
+ * Appends one 8 byte number to the current section.
+ */
+void SnapshotWriter::writeWord(uint64_t word) {
+    write(&word, sizeof(word));
+}
+
+/**
+ * Function: SnapshotWriter::endSection
+ * ------------------------------------
+ * Pads the current section with zeros so that the next one starts on an 8 byte boundary.
+ */
+void SnapshotWriter::endSection() {
+    uint64_t sectionLength = lengths[numSections - 1];
+    static const char padding[8] = {0};
+    if(position % 8 != 0) write(padding, 8 - position % 8);
+    lengths[numSections - 1] = sectionLength;
+}
+
+/**
+ * Function: SnapshotWriter::finish
+ * --------------------------------
+ * Ends the last section and writes the header with the table of sections and the checksum.  Returns
+ * whether everything was written successfully.
+ */
+bool SnapshotWriter::finish() {
+    if(numSections > 0) endSection();
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = snapshotVersion;
+    header.numSections = numSections;
+    header.payloadLength = position - sizeof(header);
+    header.checksum = checksum;
+    for(uint32_t section = 0; section < numSections; section++) {
+        header.sections[section].id = ids[section];
+        header.sections[section].offset = offsets[section];
+        header.sections[section].length = lengths[section];
+    }
+    output.seekp(0);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.close();
+    return !output.fail();
+}
+
+/**
+ * Function: SnapshotReader::open
+ * ------------------------------
+ * Maps the snapshot into memory.  Returns false if the file could not be opened, and throws an error if
+ * it is not a snapshot, was written by a different version, or does not match its checksum.
+ */
+bool SnapshotReader::open(const string& filename) {
+    if(!file.open(filename, false)) return false;
+    if(file.size() < sizeof(SnapshotHeader)) error("File is too short to be a snapshot");
+    const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(file.data());
+    if(memcmp(header->magic, snapshotMagic, sizeof(snapshotMagic)) != 0) error("File is not a snapshot");
+    if(header->version != snapshotVersion) error("Snapshot was written by a different version");
+    if(header->payloadLength != file.size() - sizeof(SnapshotHeader) ||
+            header->numSections > SnapshotWriter::maxSections)
+        error("Snapshot is truncated");
+    for(uint32_t section = 0; section < header->numSections; section++) {
+        if(header->sections[section].offset < sizeof(SnapshotHeader) ||
+                header->sections[section].offset + header->sections[section].length > file.size())
+            error("Snapshot section is out of bounds");
+    }
+    if(checksumOf(file.data() + sizeof(SnapshotHeader), header->payloadLength) != header->checksum)
+        error("Snapshot does not match its checksum");
+    return true;
+}
+
+/**
+ * Function: SnapshotReader::section
+ * ---------------------------------
+ * Finds the section with the given id and points 'bytes' at its first byte inside the mapping.  Returns
+ * false if the snapshot has no such section.
+ */
+bool SnapshotReader::section(uint32_t id, const char*& bytes, uint64_t& length) const {
+    const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(file.data());
+    for(uint32_t section = 0; section < header->numSections; section++) {
+        if(header->sections[section].id == id) {
+            bytes = file.data() + header->sections[section].offset;
+            length = header->sections[section].length;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Function: SnapshotReader::offsetOf
+ * ----------------------------------
+ * Returns where in the file a pointer into one of its sections points, so that the bytes can be read from the
+ * file itself later on.
+ */
+uint64_t SnapshotReader::offsetOf(const char* bytes) const {
+    return bytes - file.data();
+}
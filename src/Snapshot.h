@@ -0,0 +1,73 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * Snapshot
+ * --------------
+ * A snapshot is a binary file that holds an already processed database, so that it can be opened
+ * by mapping it into memory instead of parsing text.  The file starts with a fixed size header that
+ * holds a magic string, the format version, a checksum of everything after the header, and a table
+ * of sections.  Each section is a numbered run of bytes that starts on an 8 byte boundary; what is
+ * inside a section is up to whoever writes it.
+ */
+
+#ifndef _snapshot_
+#define _snapshot_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "mappedfile.h"
+
+using namespace std;
+
+/* The sections a database snapshot contains. */
+enum SnapshotSectionId {
+    ANSWER_NAMES_SECTION = 1,
+    QUESTION_NAMES_SECTION = 2,
+    OPENING_TREE_SECTION = 4,
+    COLUMNS_SECTION = 5, // every column as an array of answers or as packed bits, whichever is smaller
+    ANSWER_INDEX_SECTION = 6, // the answers in the order of the AnswerIndex
+    MERGED_NAMES_SECTION = 7, // the labels of questions that were merged into a duplicate
+    MERGED_INTO_SECTION = 8 // the question each merged label was merged into
+};
+
+class SnapshotWriter {
+public:
+
+    /* The most sections a snapshot can have, which is the size of the table of sections in the header. */
+    static const uint32_t maxSections = 16;
+
+    SnapshotWriter();
+
+    bool open(const string& filename);
+    void beginSection(uint32_t id);
+    void write(const void* bytes, size_t length);
+    void writeWord(uint64_t word);
+    bool finish();
+
+private:
+    ofstream output;
+    uint64_t checksum;
+    uint64_t pendingWord; // bytes written since the last complete 8 byte word
+    int pendingBytes;
+    uint64_t position;
+    uint32_t numSections;
+    uint32_t ids[maxSections];
+    uint64_t offsets[maxSections];
+    uint64_t lengths[maxSections];
+
+    void endSection();
+};
+
+class SnapshotReader {
+public:
+
+    bool open(const string& filename);
+    bool section(uint32_t id, const char*& bytes, uint64_t& length) const;
+    uint64_t offsetOf(const char* bytes) const;
+
+private:
+    MappedFile file;
+};
+
+#endif
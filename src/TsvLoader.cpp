@@ -0,0 +1,298 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * TsvLoader
+ * --------------
+ * The loader memory maps a "<answer>  <question/category>" file and splits it into answers,
+ * categories and the edges between them.  The mapping is private, so the names can be
+ * normalized (underscores to spaces, upper casing categories, stripping the WIKICAT and WORDNET
+ * headers) by writing into the mapping itself instead of building new strings.
+ */
+
+#include <chrono>
+#include <cstring>
+#include "TsvLoader.h"
+#include "instrument.h"
+using namespace std;
+
+/* Constants */
+static const string_view headerOne = "WIKICAT";
+static const string_view headerTwo = "WORDNET";
+static const double bytesPerMegabyte = 1024.0 * 1024.0;
+static const size_t minShardBytes = 4 * 1024 * 1024;
+
+/**
+ * Function: TsvLoader::TsvLoader
+ * ------------------------------
+ * Creates a loader that does not have a file open yet.
+ */
+TsvLoader::TsvLoader() : data(NULL), length(0), offset(0), numLines(0), parseSeconds(0.0) {
+}
+
+/**
+ * Function: TsvLoader::open
+ * -------------------------
+ * Maps the file into memory as a private, writable copy so that the names can be normalized in
+ * place without changing the file on disk.  Returns false if the file could not be opened.  The
+ * names handed out by the loader point into the mapping, so they are only valid while the loader is.
+ * Parsing starts at the offset, and if completeLinesOnly is set, a last line that does not end in a
+ * newline yet (because it is still being written) is left for the next time.
+ */
+bool TsvLoader::open(const string& filename, size_t offset, bool completeLinesOnly) {
+    if(!file.open(filename, true)) return false;
+    this->offset = min(offset, file.size());
+    data = file.data() + this->offset;
+    length = file.size() - this->offset;
+    if(completeLinesOnly) {
+        while(length > 0 && data[length - 1] != '\n') length--;
+    }
+    return true;
+}
+
+/**
+ * Function: TsvLoader::getEndOffset
+ * ---------------------------------
+ * Returns the offset in the file just past the last byte that was parsed, which is where the next piece of a
+ * growing file starts.
+ */
+size_t TsvLoader::getEndOffset() const {
+    return offset + length;
+}
+
+/**
+ * Function: TsvLoader::readKey
+ * ----------------------------
+ * Finds the next name marked with '<' and '>' between pos and the end of the line.  Returns false
+ * if the line does not have another complete name; otherwise sets the bounds of the name and moves
+ * pos past the '>'.
+ */
+bool TsvLoader::readKey(char*& pos, char* lineEnd, char*& keyBegin, char*& keyEnd) {
+    char* keyOpen = static_cast<char*>(memchr(pos, '<', lineEnd - pos));
+    if(keyOpen == NULL) return false;
+    char* keyClose = static_cast<char*>(memchr(keyOpen + 1, '>', lineEnd - keyOpen - 1));
+    if(keyClose == NULL) return false;
+    keyBegin = keyOpen + 1;
+    keyEnd = keyClose;
+    pos = keyClose + 1;
+    return true;
+}
+
+/**
+ * Function: TsvLoader::normalizeAnswer
+ * ------------------------------------
+ * Turns the underscores in an answer into spaces, in place.  Only the bytes that change are written, since
+ * writing to a page of the private mapping copies it.
+ */
+string_view TsvLoader::normalizeAnswer(char* begin, char* end) {
+    for(char* curr = begin; curr < end; curr++) {
+        if(*curr == '_') *curr = ' ';
+    }
+    return string_view(begin, end - begin);
+}
+
+/* Returns the view without any whitespace at either end. */
+static string_view trimView(string_view view) {
+    while(!view.empty() && isspace(static_cast<unsigned char>(view.front()))) view.remove_prefix(1);
+    while(!view.empty() && isspace(static_cast<unsigned char>(view.back()))) view.remove_suffix(1);
+    return view;
+}
+
+/**
+ * Function: TsvLoader::normalizeCategory
+ * --------------------------------------
+ * Turns the underscores in a category into spaces and upper cases it, in place, writing only the bytes that
+ * change (as normalizeAnswer does).  It then removes the two main headers found within the sample file, as
+ * well as the series of digits found with header two, by narrowing the view rather than copying the string.
+ */
+string_view TsvLoader::normalizeCategory(char* begin, char* end) {
+    for(char* curr = begin; curr < end; curr++) {
+        if(*curr == '_') *curr = ' ';
+        else if(*curr >= 'a' && *curr <= 'z') *curr -= 'a' - 'A';
+    }
+    string_view question(begin, end - begin);
+    if(question.find(headerOne) != string_view::npos) {
+        question = trimView(question.substr(headerOne.length()));
+    }
+    if(question.find(headerTwo) != string_view::npos) {
+        question = trimView(question.substr(headerTwo.length()));
+        while(!question.empty() && isdigit(static_cast<unsigned char>(question.back())))
+            question.remove_suffix(1);
+    }
+    return question;
+}
+
+/**
+ * Function: TsvLoader::intern
+ * ---------------------------
+ * Returns the index of the name, numbering it after every name seen so far if it is new.
+ */
+int TsvLoader::intern(unordered_map<string_view, int>& ids, vector<string_view>& names, string_view name) {
+    auto found = ids.find(name);
+    if(found != ids.end()) return found->second;
+    int index = names.size();
+    ids.emplace(name, index);
+    names.push_back(name);
+    return index;
+}
+
+/**
+ * Function: TsvLoader::parse
+ * --------------------------
+ * Splits the file into shards, parses them (in parallel on the pool when one is given and the file is big
+ * enough to be worth splitting) and merges the results.  Every unique answer and category is numbered in the
+ * order it first appears in the file, and each answer/category pair is recorded as an edge in file order.
+ */
+void TsvLoader::parse(ThreadPool* pool) {
+    auto start = chrono::steady_clock::now();
+    int numShards = 1;
+    if(pool != NULL) {
+        numShards = pool->size() + 1;
+        if(size_t(numShards) > length / minShardBytes) numShards = max(size_t(1), length / minShardBytes);
+    }
+    vector<Shard> shards = splitShards(numShards);
+    if(shards.size() > 1) {
+        pool->parallelFor(0, shards.size(), [&](int, int begin, int end) {
+            for(int shard = begin; shard < end; shard++)
+                parseShard(shards[shard]);
+        });
+    } else if(shards.size() == 1) {
+        parseShard(shards[0]);
+    }
+    mergeShards(shards, pool);
+    parseSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    INSTRUMENT_COUNT("load_bytes", length);
+    INSTRUMENT_COUNT("load_lines", numLines);
+    INSTRUMENT_COUNT("load_shards", shards.size());
+    INSTRUMENT_COUNT("load_edges", edges.size());
+}
+
+/**
+ * Function: TsvLoader::splitShards
+ * --------------------------------
+ * Cuts the file into the given number of byte ranges of about equal size.  Each cut is moved forward to just
+ * after the next newline so that no line is split between two shards.
+ */
+vector<TsvLoader::Shard> TsvLoader::splitShards(int numShards) {
+    vector<Shard> shards;
+    char* fileEnd = data + length;
+    char* begin = data;
+    for(int shard = 0; shard < numShards && begin < fileEnd; shard++) {
+        char* end = data + length * (shard + 1) / numShards;
+        if(end < begin) end = begin;
+        if(end < fileEnd) {
+            char* newline = static_cast<char*>(memchr(end, '\n', fileEnd - end));
+            end = (newline == NULL)? fileEnd: newline + 1;
+        }
+        Shard next;
+        next.begin = begin;
+        next.end = end;
+        next.numLines = 0;
+        shards.push_back(move(next));
+        begin = end;
+    }
+    return shards;
+}
+
+/**
+ * Function: TsvLoader::parseShard
+ * -------------------------------
+ * Goes through the shard one line at a time.  The first name on each line is the answer and the second
+ * is the question/category; lines without two names are skipped.  Names are numbered in the order they
+ * first appear within the shard.
+ */
+void TsvLoader::parseShard(Shard& shard) {
+    char* pos = shard.begin;
+    while(pos < shard.end) {
+        char* lineEnd = static_cast<char*>(memchr(pos, '\n', shard.end - pos));
+        if(lineEnd == NULL) lineEnd = shard.end;
+        shard.numLines++;
+        char *answerBegin, *answerEnd, *categoryBegin, *categoryEnd;
+        if(readKey(pos, lineEnd, answerBegin, answerEnd) && readKey(pos, lineEnd, categoryBegin, categoryEnd)) {
+            int answer = intern(shard.answerIds, shard.answers, normalizeAnswer(answerBegin, answerEnd));
+            int category = intern(shard.categoryIds, shard.categories, normalizeCategory(categoryBegin, categoryEnd));
+            shard.edges.push_back(make_pair(answer, category));
+        }
+        pos = lineEnd + 1;
+    }
+}
+
+/**
+ * Function: TsvLoader::mergeShards
+ * --------------------------------
+ * Combines the shards in file order.  A name that is new to the merged dictionary gets the next index, and
+ * since the shards are visited in order and each shard numbered its names in order, every name ends up with
+ * the index a serial parse would have given it.  The edges of each shard are then renumbered into their
+ * place in the merged edge list, in parallel when there is a pool.
+ */
+void TsvLoader::mergeShards(vector<Shard>& shards, ThreadPool* pool) {
+    if(shards.size() == 1) {
+        answers = move(shards[0].answers);
+        categories = move(shards[0].categories);
+        answerIds = move(shards[0].answerIds);
+        categoryIds = move(shards[0].categoryIds);
+        edges = move(shards[0].edges);
+        numLines = shards[0].numLines;
+        return;
+    }
+    vector<vector<int> > answerRemaps(shards.size());
+    vector<vector<int> > categoryRemaps(shards.size());
+    vector<size_t> edgeOffsets(shards.size() + 1, 0);
+    for(size_t shard = 0; shard < shards.size(); shard++) {
+        for(string_view name: shards[shard].answers)
+            answerRemaps[shard].push_back(intern(answerIds, answers, name));
+        for(string_view name: shards[shard].categories)
+            categoryRemaps[shard].push_back(intern(categoryIds, categories, name));
+        edgeOffsets[shard + 1] = edgeOffsets[shard] + shards[shard].edges.size();
+        numLines += shards[shard].numLines;
+    }
+    edges.resize(edgeOffsets.back());
+    auto renumber = [&](int, int begin, int end) {
+        for(int shard = begin; shard < end; shard++) {
+            pair<int, int>* out = edges.data() + edgeOffsets[shard];
+            for(const pair<int, int>& edge: shards[shard].edges)
+                *out++ = make_pair(answerRemaps[shard][edge.first], categoryRemaps[shard][edge.second]);
+        }
+    };
+    if(pool != NULL) pool->parallelFor(0, shards.size(), renumber);
+    else renumber(0, 0, shards.size());
+}
+
+/**
+ * Function: TsvLoader::printStats
+ * -------------------------------
+ * Prints how much of the file was parsed and how quickly, so that regressions in load time show up.
+ */
+void TsvLoader::printStats(ostream& out) const {
+    double megabytes = length / bytesPerMegabyte;
+    double seconds = (parseSeconds > 0.0)? parseSeconds: 1e-9;
+    out << "Parsed " << megabytes << " MB (" << numLines << " lines, " << answers.size() << " answers, "
+        << categories.size() << " categories) in " << parseSeconds << " s: "
+        << megabytes / seconds << " MB/s, " << numLines / seconds << " lines/s" << endl;
+}
+
+/**
+ * Function: TsvLoader::getAnswers
+ * -------------------------------
+ * Returns the unique answers, indexed in the order they first appear.
+ */
+const vector<string_view>& TsvLoader::getAnswers() const {
+    return answers;
+}
+
+/**
+ * Function: TsvLoader::getCategories
+ * ----------------------------------
+ * Returns the unique categories, indexed in the order they first appear.
+ */
+const vector<string_view>& TsvLoader::getCategories() const {
+    return categories;
+}
+
+/**
+ * Function: TsvLoader::getEdges
+ * -----------------------------
+ * Returns every (answer index, category index) pair in the order the lines appear in the file.
+ */
+const vector<pair<int, int> >& TsvLoader::getEdges() const {
+    return edges;
+}
@@ -0,0 +1,82 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * TsvLoader
+ * --------------
+ * The loader reads a file of "<answer>  <question/category>" lines without copying it.  The file
+ * is memory mapped, the lines are found with memchr (which the C library implements with vector
+ * instructions), and every name is normalized in place inside the mapping.  Each unique answer
+ * and category is interned once as a string_view into the mapping, so no memory is allocated
+ * per line.  The answers and categories are numbered in the order they first appear, which is
+ * the same order the database numbers them in.  Large files can be split into shards that are
+ * parsed on a ThreadPool and merged back in file order, which numbers everything exactly as a
+ * serial parse would.  A file that is still being appended to can be read a piece at a time by
+ * opening it at the offset where the last piece ended and only taking complete lines.
+ */
+
+#ifndef _tsvloader_
+#define _tsvloader_
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "mappedfile.h"
+#include "threadpool.h"
+
+using namespace std;
+
+class TsvLoader {
+public:
+
+    TsvLoader();
+
+    bool open(const string& filename, size_t offset = 0, bool completeLinesOnly = false);
+    size_t getEndOffset() const;
+    void parse(ThreadPool* pool = NULL);
+    void printStats(ostream& out) const;
+
+    const vector<string_view>& getAnswers() const;
+    const vector<string_view>& getCategories() const;
+    const vector<pair<int, int> >& getEdges() const;
+
+private:
+    /* The names, dictionaries and edges found in one byte range of the file, numbered locally. */
+    struct Shard {
+        char* begin;
+        char* end;
+        vector<string_view> answers;
+        vector<string_view> categories;
+        unordered_map<string_view, int> answerIds;
+        unordered_map<string_view, int> categoryIds;
+        vector<pair<int, int> > edges;
+        size_t numLines;
+    };
+
+    MappedFile file; // privately mapped, so names can be normalized in place
+    char* data;
+    size_t length;
+    size_t offset; // where data starts in the file
+
+    vector<string_view> answers; // answer index to name
+    vector<string_view> categories; // category index to name
+    unordered_map<string_view, int> answerIds;
+    unordered_map<string_view, int> categoryIds;
+    vector<pair<int, int> > edges; // (answer index, category index) in file order
+
+    size_t numLines;
+    double parseSeconds;
+
+    vector<Shard> splitShards(int numShards);
+    void parseShard(Shard& shard);
+    void mergeShards(vector<Shard>& shards, ThreadPool* pool);
+    bool readKey(char*& pos, char* lineEnd, char*& keyBegin, char*& keyEnd);
+    string_view normalizeAnswer(char* begin, char* end);
+    string_view normalizeCategory(char* begin, char* end);
+    static int intern(unordered_map<string_view, int>& ids, vector<string_view>& names, string_view name);
+};
+
+#endif
@@ -0,0 +1,170 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * TurnPipeline
+ * --------------
+ * The pipeline keeps one worker thread per possible response to the turn the user is being asked.  Each
+ * worker copies the session, gives the copy the response and asks it for its next question.  The session
+ * itself is only read by the workers while they copy it, and is only written once every worker has been
+ * joined, so the session never needs a lock.
+ */
+
+#include "TurnPipeline.h"
+#include "instrument.h"
+using namespace std;
+
+/* Constants */
+static const int maxNumQuestions = 20;
+static const string SENTINEL = "EMPTY_SET";
+
+/**
+ * Function: TurnPipeline::TurnPipeline
+ * ------------------------------------
+ * Starts a pipeline for the session, which has nothing worked out yet.
+ */
+TurnPipeline::TurnPipeline(Session& session) :
+    session(session),
+    cancelled(false),
+    speculating(false),
+    pendingGuess(false),
+    pendingTurn(0),
+    ready(false),
+    readyGuess(false),
+    readyTurn(0) {
+}
+
+/**
+ * Function: TurnPipeline::~TurnPipeline
+ * -------------------------------------
+ * Cancels whatever is still being worked out.
+ */
+TurnPipeline::~TurnPipeline() {
+    cancel();
+}
+
+/**
+ * Function: TurnPipeline::getNextQuestion
+ * ---------------------------------------
+ * Works just like Session::getNextQuestion, except that the question is usually already known from the
+ * last turn.  Once the question is picked, the branches for the responses the user can give are started
+ * in the background, unless the session has run out of candidates or this is the last turn, after which no
+ * question is asked.
+ */
+bool TurnPipeline::getNextQuestion(string& question, int numQuestion) {
+    bool guess;
+    if(ready && readyTurn == numQuestion) {
+        INSTRUMENT_COUNT("pipeline_hits", 1);
+        question = readyQuestion;
+        guess = readyGuess;
+        ready = false;
+    } else {
+        cancel();
+        guess = session.getNextQuestion(question, numQuestion);
+    }
+    if((!guess && question == SENTINEL) || numQuestion >= maxNumQuestions) return guess;
+    pendingQuestion = question;
+    pendingGuess = guess;
+    pendingTurn = numQuestion;
+    cancelled = false;
+    speculating = true;
+    if(!guess) speculate(yesBranch, true);
+    speculate(noBranch, false);
+    return guess;
+}
+
+/**
+ * Function: TurnPipeline::updateDatabase
+ * --------------------------------------
+ * Works just like Session::updateDatabase.  If the response is to the question being worked on, the
+ * branch for it replaces the session; otherwise the response is applied to the session directly.
+ */
+void TurnPipeline::updateDatabase(bool response, const string& question, int numQuestion) {
+    if(speculating && !pendingGuess && question == pendingQuestion && numQuestion == pendingTurn &&
+       adopt(response? yesBranch: noBranch, numQuestion + 1)) return;
+    cancel();
+    session.updateDatabase(response, question, numQuestion);
+}
+
+/**
+ * Function: TurnPipeline::removeIncorrectGuess
+ * --------------------------------------------
+ * Works just like Session::removeIncorrectGuess.  If the guess is the one being worked on, the branch in
+ * which it was rejected replaces the session; otherwise the guess is removed from the session directly.
+ */
+void TurnPipeline::removeIncorrectGuess(const string& guess) {
+    if(speculating && pendingGuess && guess == pendingQuestion && adopt(noBranch, pendingTurn + 1)) return;
+    cancel();
+    session.removeIncorrectGuess(guess);
+}
+
+/**
+ * Function: TurnPipeline::cancel
+ * ------------------------------
+ * Stops working on the pending turn, waits for the workers and throws away what they worked out, along with
+ * the next question if it was already known.  After this the session can be used directly again.
+ */
+void TurnPipeline::cancel() {
+    cancelled = true;
+    join(yesBranch);
+    join(noBranch);
+    yesBranch.session.reset();
+    noBranch.session.reset();
+    speculating = false;
+    ready = false;
+}
+
+/**
+ * Function: TurnPipeline::speculate
+ * ---------------------------------
+ * Starts a worker that plays the pending turn with the given response on a copy of the session, and then
+ * finds the copy's next question.  The worker gives up between steps once the pipeline is cancelled, and the
+ * search for the next question checks for it as it goes, so cancelling never waits for a whole scan.
+ */
+void TurnPipeline::speculate(Branch& branch, bool response) {
+    branch.done = false;
+    branch.worker = thread([this, &branch, response]() {
+        INSTRUMENT_TIMER("pipeline_speculate");
+        unique_ptr<Session> copy(new Session(session));
+        if(cancelled) return;
+        if(pendingGuess) copy->removeIncorrectGuess(pendingQuestion);
+        else copy->updateDatabase(response, pendingQuestion, pendingTurn);
+        if(cancelled) return;
+        branch.guess = copy->getNextQuestion(branch.question, pendingTurn + 1, &cancelled);
+        if(cancelled) return;
+        branch.session = move(copy);
+        branch.done = true;
+    });
+}
+
+/**
+ * Function: TurnPipeline::adopt
+ * -----------------------------
+ * Waits for the branch, cancels the other one and, if the branch got all the way to its next question, makes
+ * its copy the session and remembers the question for the given turn.  The other branch is waited for too,
+ * since it may still be copying the session.  Returns false, without changing the session, if the branch
+ * did not finish.
+ */
+bool TurnPipeline::adopt(Branch& branch, int numQuestion) {
+    join(branch);
+    cancelled = true;
+    join(&branch == &yesBranch? noBranch: yesBranch);
+    speculating = false;
+    if(!branch.done) return false;
+    session = move(*branch.session);
+    yesBranch.session.reset();
+    noBranch.session.reset();
+    ready = true;
+    readyQuestion = branch.question;
+    readyGuess = branch.guess;
+    readyTurn = numQuestion;
+    return true;
+}
+
+/**
+ * Function: TurnPipeline::join
+ * ----------------------------
+ * Waits for the branch's worker, if it has one.
+ */
+void TurnPipeline::join(Branch& branch) {
+    if(branch.worker.joinable()) branch.worker.join();
+}
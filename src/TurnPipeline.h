@@ -0,0 +1,73 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * TurnPipeline
+ * --------------
+ * A turn pipeline plays a Session while the user is thinking.  As soon as the session has picked
+ * a question, the pipeline works out in the background what the session would ask next if the user
+ * says yes and what it would ask if they say no, each on its own copy of the session.  For a guess
+ * it only works out the turn after the guess is rejected, since a right guess ends the game.  When
+ * the response arrives, the copy for that response simply replaces the session and its next question
+ * is already known, so applying the response and finding the next question is just a lookup.
+ *
+ * While anything is being worked out, the session must only be used through the pipeline.  A response
+ * to anything other than the question the pipeline is working on throws the speculation away and is
+ * applied to the session directly.  cancel() stops the speculation (the copies give up between steps,
+ * and partway through the search for a question) and waits for it, and must be called before the
+ * session is used directly again, such as when the player gives up or quits; the destructor calls it
+ * as well.  Nothing is worked out after the last turn, since no question follows it.
+ */
+
+#ifndef _turnpipeline_
+#define _turnpipeline_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include "Session.h"
+
+using namespace std;
+
+class TurnPipeline {
+public:
+
+    TurnPipeline(Session& session);
+    ~TurnPipeline();
+
+    bool getNextQuestion(string& question, int numQuestion);
+    void updateDatabase(bool response, const string& question, int numQuestion);
+    void removeIncorrectGuess(const string& guess);
+    void cancel();
+
+private:
+    struct Branch {
+        thread worker;
+        unique_ptr<Session> session; // the copy that was given the response, once the worker has made it
+        string question; // what the copy asks next
+        bool guess; // whether that is a guess
+        bool done; // whether the copy got all the way to its next question
+    };
+
+    Session& session;
+    atomic<bool> cancelled; // tells the workers to stop between steps
+    Branch yesBranch; // the question was answered yes
+    Branch noBranch; // the question was answered no, or the guess was rejected
+    bool speculating; // whether the branches are for the pending turn
+    string pendingQuestion; // the question or guess the user is being asked
+    bool pendingGuess;
+    int pendingTurn;
+    bool ready; // whether the next question has already been worked out
+    string readyQuestion;
+    bool readyGuess;
+    int readyTurn;
+
+    TurnPipeline(const TurnPipeline&) = delete;
+    TurnPipeline& operator =(const TurnPipeline&) = delete;
+
+    void speculate(Branch& branch, bool response);
+    bool adopt(Branch& branch, int numQuestion);
+    void join(Branch& branch);
+};
+
+#endif
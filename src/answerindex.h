@@ -0,0 +1,246 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * AnswerIndex
+ * --------------
+ * This class finds answers by a name the user typed, which may not match the stored name exactly.
+ * It holds nothing but the answer ids, sorted by name with case and underscores folded away (so
+ * "50_cent" and "50 Cent" compare the same), and reads the names themselves from the InternTable
+ * they were interned in.  That is four bytes per answer.  A name that matches up to folding, or
+ * every name that starts with a prefix, is a binary search.  Names within a few edits of a misspelt
+ * one are found by walking the sorted ids as if they were a trie: neighbouring names share their
+ * prefixes, so the edit distance table of a prefix is only worked out once, and once a prefix is
+ * too far off, every name that starts with it is skipped with a binary search.
+ */
+
+#ifndef _answerindex_
+#define _answerindex_
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "bitvector.h"
+#include "interntable.h"
+
+class AnswerIndex {
+
+public:
+
+    /**
+     * AnswerIndex::build
+     * ------------------
+     * Sorts every name in the table.  Names that only differ in case are ordered by id.
+     */
+    void build(const InternTable& names) {
+        order.resize(names.size());
+        for(int id = 0; id < names.size(); id++)
+            order[id] = id;
+        std::sort(order.begin(), order.end(), [&names](int32_t first, int32_t second) {
+            return comesBefore(names, first, second);
+        });
+    }
+
+    /**
+     * AnswerIndex::assign
+     * -------------------
+     * Takes the order of the names from ids that were already sorted (such as the ones in a snapshot).  Returns
+     * false, leaving the index empty, unless they are every id in the table exactly once and in order.
+     */
+    bool assign(const InternTable& names, const uint32_t* sorted, int count) {
+        order.clear();
+        if(count != names.size()) return false;
+        BitVector seen(count);
+        for(int position = 0; position < count; position++) {
+            if(sorted[position] >= uint32_t(count) || seen.test(sorted[position])) return false;
+            seen.set(sorted[position]);
+            if(position > 0 && !comesBefore(names, sorted[position - 1], sorted[position])) return false;
+        }
+        order.assign(sorted, sorted + count);
+        return true;
+    }
+
+    /**
+     * AnswerIndex::insert
+     * -------------------
+     * Adds a name that was just interned into its place in the order.
+     */
+    void insert(const InternTable& names, int id) {
+        order.insert(std::upper_bound(order.begin(), order.end(), id, [&names](int32_t first, int32_t second) {
+            return comesBefore(names, first, second);
+        }), id);
+    }
+
+    /**
+     * AnswerIndex::size
+     * -----------------
+     * Returns the number of names in the index.
+     */
+    int size() const {
+        return order.size();
+    }
+
+    /**
+     * AnswerIndex::at
+     * ---------------
+     * Returns the id of the name at the given position in sorted order.
+     */
+    int at(int position) const {
+        return order[position];
+    }
+
+    /**
+     * AnswerIndex::data
+     * -----------------
+     * Returns the ids in sorted order, to be saved and given back to assign.
+     */
+    const int32_t* data() const {
+        return order.data();
+    }
+
+    /**
+     * AnswerIndex::find
+     * -----------------
+     * Returns the id of a name that is the same as the query up to folding, or -1 if there is none.  If several
+     * are, it returns the one with the lowest id.
+     */
+    int find(const InternTable& names, std::string_view query) const {
+        std::pair<int, int> range = prefixRange(names, query);
+        if(range.first == range.second || names.name(order[range.first]).length() != query.length()) return -1;
+        return order[range.first];
+    }
+
+    /**
+     * AnswerIndex::prefixRange
+     * ------------------------
+     * Returns the positions [first, second) in sorted order of the names that start with the prefix, up to folding.
+     */
+    std::pair<int, int> prefixRange(const InternTable& names, std::string_view prefix) const {
+        return prefixRange(names, prefix, 0);
+    }
+
+    /**
+     * AnswerIndex::findNear
+     * ---------------------
+     * Adds the ids of up to maxResults names that can be turned into the query (up to folding) with at most
+     * maxEdits insertions, deletions or substitutions, closest first and in sorted order among equally close ones.
+     */
+    void findNear(const InternTable& names, std::string_view query, int maxEdits, int maxResults,
+                  std::vector<int>& ids) const {
+        int width = query.length() + 1;
+        std::vector<int> rows(width);
+        for(int column = 0; column < width; column++)
+            rows[column] = column;
+        std::vector<std::pair<int, int> > found; // distance and position of every match
+        std::string_view previous;
+        int known = 0; // the number of characters of previous whose rows are still in the table
+        int position = 0;
+        while(position < size()) {
+            std::string_view name = names.name(order[position]);
+            int depth = 0;
+            while(depth < known && depth < int(name.length()) && fold(name[depth]) == fold(previous[depth])) depth++;
+            if(rows.size() < (name.length() + 1) * width) rows.resize((name.length() + 1) * width);
+            bool tooFar = false;
+            for(; depth < int(name.length()) && !tooFar; depth++)
+                tooFar = fillRow(rows.data() + depth * width, name[depth], query, maxEdits);
+            previous = name;
+            known = depth;
+            if(tooFar) {
+                position = skipPrefix(names, name.substr(0, depth), position);
+                continue;
+            }
+            int distance = rows[name.length() * width + width - 1];
+            if(distance <= maxEdits) found.push_back(std::make_pair(distance, position));
+            position++;
+        }
+        std::sort(found.begin(), found.end());
+        for(int i = 0; i < int(found.size()) && i < maxResults; i++)
+            ids.push_back(order[found[i].second]);
+    }
+
+    /**
+     * AnswerIndex::memoryUsage
+     * ------------------------
+     * Returns the number of bytes the index has allocated.
+     */
+    size_t memoryUsage() const {
+        return order.capacity() * sizeof(int32_t);
+    }
+
+private:
+    std::vector<int32_t> order; // every id, sorted by folded name and then by id
+
+    /* Returns the character as it is compared: lower case, with underscores as spaces. */
+    static char fold(char c) {
+        if(c == '_') return ' ';
+        return (c >= 'A' && c <= 'Z')? c + ('a' - 'A'): c;
+    }
+
+    /*
+     * Compares the start of the name with the prefix, up to folding: negative if the name sorts before every name
+     * with the prefix, 0 if it starts with it and positive if it sorts after them.
+     */
+    static int comparePrefix(std::string_view name, std::string_view prefix) {
+        for(size_t i = 0; i < prefix.length(); i++) {
+            if(i == name.length()) return -1;
+            unsigned char first = fold(name[i]), second = fold(prefix[i]);
+            if(first != second) return (first < second)? -1: 1;
+        }
+        return 0;
+    }
+
+    /* Returns whether the first id sorts before the second. */
+    static bool comesBefore(const InternTable& names, int first, int second) {
+        std::string_view firstName = names.name(first), secondName = names.name(second);
+        size_t common = std::min(firstName.length(), secondName.length());
+        int compared = comparePrefix(firstName.substr(0, common), secondName.substr(0, common));
+        if(compared != 0) return compared < 0;
+        if(firstName.length() != secondName.length()) return firstName.length() < secondName.length();
+        return first < second;
+    }
+
+    /* Returns the positions of the names with the prefix, searching from the given position on. */
+    std::pair<int, int> prefixRange(const InternTable& names, std::string_view prefix, int from) const {
+        std::vector<int32_t>::const_iterator first = std::partition_point(order.begin() + from, order.end(),
+            [&](int32_t id) { return comparePrefix(names.name(id), prefix) < 0; });
+        std::vector<int32_t>::const_iterator second = std::partition_point(first, order.end(),
+            [&](int32_t id) { return comparePrefix(names.name(id), prefix) == 0; });
+        return std::make_pair(first - order.begin(), second - order.begin());
+    }
+
+    /*
+     * Returns the position of the first name after the given one that does not start with the prefix.  Few names
+     * usually share a prefix that was too far off, so it looks one, two, four... names ahead before searching.
+     */
+    int skipPrefix(const InternTable& names, std::string_view prefix, int position) const {
+        int step = 1, last = position;
+        while(last + step < size() && comparePrefix(names.name(order[last + step]), prefix) == 0) {
+            last += step;
+            step *= 2;
+        }
+        std::vector<int32_t>::const_iterator end = order.begin() + std::min(last + step, size());
+        return std::partition_point(order.begin() + last + 1, end,
+            [&](int32_t id) { return comparePrefix(names.name(id), prefix) == 0; }) - order.begin();
+    }
+
+    /*
+     * Fills the row after the given one of the edit distance table, for a name whose next character is c.  Entry
+     * j of a row is the distance between the name so far and the first j characters of the query.  Returns
+     * whether every entry is more than maxEdits, in which case no name that goes on from here can match.
+     */
+    static bool fillRow(int* row, char c, std::string_view query, int maxEdits) {
+        int width = query.length() + 1;
+        int* next = row + width;
+        next[0] = row[0] + 1;
+        int best = next[0];
+        for(int column = 1; column < width; column++) {
+            int substitute = row[column - 1] + (fold(query[column - 1]) != fold(c));
+            next[column] = std::min(substitute, std::min(row[column], next[column - 1]) + 1);
+            best = std::min(best, next[column]);
+        }
+        return best > maxEdits;
+    }
+};
+
+#endif
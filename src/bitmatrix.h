@@ -0,0 +1,207 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * BitMatrix
+ * --------------
+ * This class stores the relation between answers (rows) and questions (columns) as a
+ * grid of bits.  The bits are stored column by column, where every question owns a
+ * HybridColumn holding the answers that fit it: a sorted array of them while there are few,
+ * and a bit for each answer once there are many.  Since most questions fit only a handful of
+ * answers, this takes a small fraction of the room of a bit for every answer and question,
+ * while counting how many of the remaining candidates answer "yes" to a common question is
+ * still a single pass of bitwise and / popcount over its column.
+ * The columns are shared between copies of a matrix until one of the copies writes to them, so
+ * copying a matrix only copies a pointer per column, and a copy that then sets a few bits only
+ * clones the columns it touched.  Growing the number of rows does not touch any column either:
+ * a column has no length of its own, so the new answers simply are not in it until they are set.
+ * A column can also be offloaded, when it is kept on disk instead (see ColumnCache).  The matrix then
+ * only remembers that it does not hold the column, and whoever offloaded it has to find it elsewhere.
+ */
+
+#ifndef _bitmatrix_
+#define _bitmatrix_
+
+#include <memory>
+#include <vector>
+#include "bitvector.h"
+#include "hybridcolumn.h"
+
+class BitMatrix {
+
+public:
+
+    /**
+     * BitMatrix::BitMatrix
+     * --------------------
+     * Creates a matrix with the given dimensions where every bit is cleared.
+     */
+    BitMatrix(int numRows = 0, int numCols = 0) : rows(0) {
+        resize(numRows, numCols);
+    }
+
+    /**
+     * BitMatrix::numRows
+     * ------------------
+     * Returns the number of rows (answers) the matrix has room for.
+     */
+    int numRows() const {
+        return rows;
+    }
+
+    /**
+     * BitMatrix::numCols
+     * ------------------
+     * Returns the number of columns (questions) the matrix has room for.
+     */
+    int numCols() const {
+        return columns.size();
+    }
+
+    /**
+     * BitMatrix::resize
+     * -----------------
+     * Changes the dimensions of the matrix while keeping every bit that still fits.  New columns start
+     * out clear, and existing columns are only written to when rows are cut off, so that they stay shared.
+     */
+    void resize(int numRows, int numCols) {
+        int oldCols = columns.size();
+        columns.resize(numCols);
+        for(int col = 0; col < numCols; col++) {
+            if(col >= oldCols) columns[col] = std::make_shared<HybridColumn>();
+            else if(numRows < rows && isResident(col)) writable(col).truncate(numRows);
+        }
+        rows = numRows;
+    }
+
+    /**
+     * BitMatrix::isResident
+     * ---------------------
+     * Returns whether the matrix holds the column, rather than it having been offloaded.
+     */
+    bool isResident(int col) const {
+        return columns[col] != NULL;
+    }
+
+    /**
+     * BitMatrix::offload
+     * ------------------
+     * Lets go of the column, which is freed unless another matrix or reader still shares it.
+     */
+    void offload(int col) {
+        columns[col].reset();
+    }
+
+    /**
+     * BitMatrix::restore
+     * ------------------
+     * Puts an offloaded column back into the matrix.
+     */
+    void restore(int col, std::shared_ptr<HybridColumn> column) {
+        columns[col] = column;
+    }
+
+    /**
+     * BitMatrix::share
+     * ----------------
+     * Returns a pointer to a resident column that keeps it alive even if the matrix lets go of it.
+     */
+    std::shared_ptr<const HybridColumn> share(int col) const {
+        return columns[col];
+    }
+
+    /**
+     * BitMatrix::get
+     * --------------
+     * Returns whether or not the bit for the given answer and question is set.  The column must be resident,
+     * as it must be for every method below that takes a column.
+     */
+    bool get(int row, int col) const {
+        return columns[col]->test(row);
+    }
+
+    /**
+     * BitMatrix::set
+     * --------------
+     * Sets the bit for the given answer and question.
+     */
+    void set(int row, int col) {
+        writable(col).set(row, rows);
+    }
+
+    /**
+     * BitMatrix::column
+     * -----------------
+     * Returns the answers that fit the given question.
+     */
+    const HybridColumn& column(int col) const {
+        return *columns[col];
+    }
+
+    /**
+     * BitMatrix::loadColumn
+     * ---------------------
+     * Replaces the bits of a column with numRows() bits copied from packed words.  The column is stored
+     * in whichever way is smaller.
+     */
+    void loadColumn(int col, const uint64_t* packed) {
+        writable(col).assign(packed, rows);
+    }
+
+    /**
+     * BitMatrix::loadRows
+     * -------------------
+     * Replaces a column with the given answers, which must be in increasing order and less than numRows().
+     */
+    void loadRows(int col, const uint32_t* sorted, int count) {
+        writable(col).assign(sorted, count, rows);
+    }
+
+    /**
+     * BitMatrix::keepColumns
+     * ----------------------
+     * Keeps only the given columns, in the given order, so that column i becomes what column cols[i] was.
+     * The columns are moved rather than copied.
+     */
+    void keepColumns(const std::vector<int>& cols) {
+        std::vector<std::shared_ptr<HybridColumn> > kept;
+        kept.reserve(cols.size());
+        for(int col: cols)
+            kept.push_back(columns[col]);
+        columns.swap(kept);
+    }
+
+    /**
+     * BitMatrix::countAnd
+     * -------------------
+     * Returns how many of the rows marked in the given vector have the bit set in the column.
+     */
+    int countAnd(int col, const BitVector& rowMask) const {
+        return columns[col]->andCount(rowMask);
+    }
+
+    /**
+     * BitMatrix::memoryUsage
+     * ----------------------
+     * Returns roughly how many bytes the resident columns take.  Columns that are shared with another matrix
+     * are counted in full by both.
+     */
+    size_t memoryUsage() const {
+        size_t bytes = columns.capacity() * sizeof(std::shared_ptr<HybridColumn>);
+        for(const std::shared_ptr<HybridColumn>& column: columns) {
+            if(column != NULL) bytes += column->memoryUsage();
+        }
+        return bytes;
+    }
+
+private:
+    std::vector<std::shared_ptr<HybridColumn> > columns;
+    int rows;
+
+    /* Returns the column for writing, first cloning it if any other matrix still shares it. */
+    HybridColumn& writable(int col) {
+        if(columns[col].use_count() > 1) columns[col] = std::make_shared<HybridColumn>(*columns[col]);
+        return *columns[col];
+    }
+};
+
+#endif
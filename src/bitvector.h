@@ -0,0 +1,254 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * BitVector
+ * --------------
+ * This class is a fixed width vector of bits packed 64 to a word.  It is used to store
+ * one column of the answer/question incidence matrix as well as the set of answers
+ * that are still candidates.  Since the bits are packed, counting how many answers
+ * two vectors have in common is a bitwise and followed by a popcount on each word,
+ * which is much cheaper than testing every answer one at a time.
+ */
+
+#ifndef _bitvector_
+#define _bitvector_
+
+#include <cstdint>
+#include <vector>
+
+class BitVector {
+
+public:
+
+    /**
+     * BitVector::BitVector
+     * --------------------
+     * Creates a bit vector with the given number of bits, all cleared.
+     */
+    explicit BitVector(int numBits = 0) {
+        resize(numBits);
+    }
+
+    /**
+     * BitVector::size
+     * ---------------
+     * Returns the number of bits in the vector.
+     */
+    int size() const {
+        return numBits;
+    }
+
+    /**
+     * BitVector::resize
+     * -----------------
+     * Changes the number of bits in the vector.  Bits that are added are cleared and
+     * bits that are cut off are forgotten.
+     */
+    void resize(int newNumBits) {
+        numBits = newNumBits;
+        words.resize(wordsFor(newNumBits), 0);
+        clearTail();
+    }
+
+    /**
+     * BitVector::set
+     * --------------
+     * Sets the bit at the given index.
+     */
+    void set(int index) {
+        words[index / bitsPerWord] |= bitFor(index);
+    }
+
+    /**
+     * BitVector::reset
+     * ----------------
+     * Clears the bit at the given index.
+     */
+    void reset(int index) {
+        words[index / bitsPerWord] &= ~bitFor(index);
+    }
+
+    /**
+     * BitVector::test
+     * ---------------
+     * Returns whether or not the bit at the given index is set.
+     */
+    bool test(int index) const {
+        return (words[index / bitsPerWord] & bitFor(index)) != 0;
+    }
+
+    /**
+     * BitVector::setAll
+     * -----------------
+     * Sets every bit in the vector.
+     */
+    void setAll() {
+        for(uint64_t& word: words)
+            word = ~uint64_t(0);
+        clearTail();
+    }
+
+    /**
+     * BitVector::count
+     * ----------------
+     * Returns the number of bits that are set.
+     */
+    int count() const {
+        int total = 0;
+        for(uint64_t word: words)
+            total += __builtin_popcountll(word);
+        return total;
+    }
+
+    /**
+     * BitVector::equals
+     * -----------------
+     * Returns whether both vectors have the same number of bits and the same bits set.
+     */
+    bool equals(const BitVector& other) const {
+        return numBits == other.numBits && words == other.words;
+    }
+
+    /**
+     * BitVector::hash
+     * ---------------
+     * Returns a hash of the set bits, so that equal vectors can be found without comparing every pair.
+     */
+    uint64_t hash() const {
+        uint64_t hash = 14695981039346656037ull;
+        for(uint64_t word: words)
+            hash = (hash ^ word) * 1099511628211ull;
+        return hash;
+    }
+
+    /**
+     * BitVector::andCount
+     * -------------------
+     * Returns the number of bits set in both this vector and the other one.  The
+     * loop keeps four independent sums so that the compiler can overlap the popcounts
+     * (or turn them into SIMD instructions) instead of waiting on a single total.
+     */
+    int andCount(const BitVector& other) const {
+        int numWords = int(words.size() < other.words.size() ? words.size() : other.words.size());
+        const uint64_t* first = words.data();
+        const uint64_t* second = other.words.data();
+        int sumOne = 0, sumTwo = 0, sumThree = 0, sumFour = 0;
+        int word = 0;
+        for(; word + 4 <= numWords; word += 4) {
+            sumOne += __builtin_popcountll(first[word] & second[word]);
+            sumTwo += __builtin_popcountll(first[word + 1] & second[word + 1]);
+            sumThree += __builtin_popcountll(first[word + 2] & second[word + 2]);
+            sumFour += __builtin_popcountll(first[word + 3] & second[word + 3]);
+        }
+        for(; word < numWords; word++)
+            sumOne += __builtin_popcountll(first[word] & second[word]);
+        return sumOne + sumTwo + sumThree + sumFour;
+    }
+
+    /**
+     * BitVector::intersect
+     * --------------------
+     * Clears every bit that is not also set in the other vector.  Bits past the end of a shorter
+     * other vector count as clear, so they are cleared here too.
+     */
+    void intersect(const BitVector& other) {
+        int shared = int(words.size() < other.words.size() ? words.size() : other.words.size());
+        for(int word = 0; word < shared; word++)
+            words[word] &= other.words[word];
+        for(int word = shared; word < int(words.size()); word++)
+            words[word] = 0;
+    }
+
+    /**
+     * BitVector::subtract
+     * -------------------
+     * Clears every bit that is set in the other vector.
+     */
+    void subtract(const BitVector& other) {
+        int shared = int(words.size() < other.words.size() ? words.size() : other.words.size());
+        for(int word = 0; word < shared; word++)
+            words[word] &= ~other.words[word];
+    }
+
+    /**
+     * BitVector::unite
+     * ----------------
+     * Sets every bit that is set in the other vector, which must not be longer than this one.
+     */
+    void unite(const BitVector& other) {
+        for(int word = 0; word < int(other.words.size()); word++)
+            words[word] |= other.words[word];
+    }
+
+    /**
+     * BitVector::numWords
+     * -------------------
+     * Returns the number of 64 bit words the bits are packed into.
+     */
+    int numWords() const {
+        return words.size();
+    }
+
+    /**
+     * BitVector::data
+     * ---------------
+     * Returns the packed words, with bit i stored in bit (i % 64) of word (i / 64).
+     */
+    const uint64_t* data() const {
+        return words.data();
+    }
+
+    /**
+     * BitVector::assign
+     * -----------------
+     * Replaces the contents with the given number of bits copied from packed words laid out like data().
+     */
+    void assign(const uint64_t* packed, int newNumBits) {
+        numBits = newNumBits;
+        words.assign(packed, packed + wordsFor(newNumBits));
+        clearTail();
+    }
+
+    /**
+     * BitVector::forEachSet
+     * ---------------------
+     * Calls the function with the index of every set bit, in increasing order.
+     */
+    template <typename Function>
+    void forEachSet(Function function) const {
+        for(int word = 0; word < int(words.size()); word++) {
+            uint64_t bits = words[word];
+            while(bits != 0) {
+                function(word * bitsPerWord + __builtin_ctzll(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    /**
+     * BitVector::wordsFor
+     * -------------------
+     * Returns the number of words needed to hold the given number of bits.
+     */
+    static int wordsFor(int bits) {
+        return (bits + bitsPerWord - 1) / bitsPerWord;
+    }
+
+private:
+    static const int bitsPerWord = 64;
+
+    std::vector<uint64_t> words;
+    int numBits;
+
+    static uint64_t bitFor(int index) {
+        return uint64_t(1) << (index % bitsPerWord);
+    }
+
+    /* Keeps the unused bits of the last word cleared so counts never see them. */
+    void clearTail() {
+        if(numBits % bitsPerWord != 0)
+            words.back() &= (uint64_t(1) << (numBits % bitsPerWord)) - 1;
+    }
+};
+
+#endif
@@ -0,0 +1,238 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * ColumnCache
+ * --------------
+ * This class keeps incidence columns on disk and reads them back when they are needed, for databases
+ * that are given a memory budget.  Every column in the file is stored the way a snapshot stores it: a
+ * word that is 0 for an array of answers or 1 for packed bits, the number of entries, and then the answers
+ * as 32 bit numbers (padded to a whole word) or a word of bits for every 64 answers.  A column is known by
+ * its offset in the file.  The file is either a snapshot, whose columns are read in place, or a temporary
+ * file that columns are spilled into, which is removed when the cache is destroyed.
+ * The columns that were read most recently are kept in memory, up to a number of bytes, and the least
+ * recently used one is dropped first.  Columns are handed out as shared pointers, so a column that is
+ * dropped while someone is still reading it stays alive until they are done.  Any number of threads may
+ * read columns at once; the cache (and the file) is only used by one of them at a time.
+ */
+
+#ifndef _columncache_
+#define _columncache_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "hybridcolumn.h"
+#include "error.h"
+#include "instrument.h"
+
+class ColumnCache {
+
+public:
+
+    /* What the cache has done so far, to size budgets with. */
+    struct Stats {
+        uint64_t hits; // columns that were found in memory
+        uint64_t misses; // columns that had to be read from the file
+        uint64_t bytesRead;
+        double ioSeconds; // time spent reading and unpacking columns
+        size_t cachedBytes; // the size of the columns in memory now
+        size_t capacity;
+    };
+
+    /**
+     * ColumnCache::ColumnCache
+     * ------------------------
+     * Creates a cache that keeps up to the given number of bytes of columns in memory, with no file yet.
+     */
+    explicit ColumnCache(size_t capacity) :
+        file(NULL), fileEnd(0), capacity(capacity), cachedBytes(0), hits(0), misses(0), bytesRead(0), ioSeconds(0.0) {
+    }
+
+    /**
+     * ColumnCache::~ColumnCache
+     * -------------------------
+     * Closes the file, which removes it if it was temporary.
+     */
+    ~ColumnCache() {
+        if(file != NULL) fclose(file);
+    }
+
+    /**
+     * ColumnCache::open
+     * -----------------
+     * Reads columns from an existing file, such as a snapshot.  The file must not be changed while the cache
+     * is in use.  Returns false if it could not be opened.
+     */
+    bool open(const std::string& filename) {
+        file = fopen(filename.c_str(), "rb");
+        this->filename = filename;
+        return file != NULL;
+    }
+
+    /**
+     * ColumnCache::create
+     * -------------------
+     * Starts a new temporary file to spill columns into.  Returns false if it could not be created.
+     */
+    bool create() {
+        file = tmpfile();
+        filename = "";
+        fileEnd = 0;
+        return file != NULL;
+    }
+
+    /**
+     * ColumnCache::getFilename
+     * ------------------------
+     * Returns the name of the file the columns are read from, or an empty string for a temporary file.
+     */
+    const std::string& getFilename() const {
+        return filename;
+    }
+
+    /**
+     * ColumnCache::append
+     * -------------------
+     * Writes the column of a matrix with numRows answers to the end of a temporary file, and returns its offset.
+     */
+    uint64_t append(const HybridColumn& column, int numRows) {
+        std::vector<uint64_t> words;
+        encode(column, numRows, words);
+        std::lock_guard<std::mutex> guard(lock);
+        uint64_t offset = fileEnd;
+        if(fseek(file, long(offset), SEEK_SET) != 0 || fwrite(words.data(), sizeof(uint64_t), words.size(), file) != words.size())
+            error("Could not write to the column file");
+        fileEnd += words.size() * sizeof(uint64_t);
+        return offset;
+    }
+
+    /**
+     * ColumnCache::get
+     * ----------------
+     * Returns the column at the offset, of a matrix with numRows answers, reading it from the file unless it is
+     * already in memory.  Reading it may drop the columns that were used least recently.
+     */
+    std::shared_ptr<const HybridColumn> get(uint64_t offset, int numRows) {
+        std::lock_guard<std::mutex> guard(lock);
+        std::unordered_map<uint64_t, std::list<Entry>::iterator>::iterator found = entries.find(offset);
+        if(found != entries.end()) {
+            hits++;
+            INSTRUMENT_COUNT("column_cache_hits", 1);
+            recent.splice(recent.begin(), recent, found->second);
+            return found->second->column;
+        }
+        misses++;
+        INSTRUMENT_COUNT("column_cache_misses", 1);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::shared_ptr<const HybridColumn> column = read(offset, numRows);
+        ioSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        recent.push_front(Entry{offset, column});
+        entries[offset] = recent.begin();
+        cachedBytes += column->memoryUsage();
+        while(cachedBytes > capacity && recent.size() > 1) {
+            cachedBytes -= recent.back().column->memoryUsage();
+            entries.erase(recent.back().offset);
+            recent.pop_back();
+        }
+        return column;
+    }
+
+    /**
+     * ColumnCache::stats
+     * ------------------
+     * Returns what the cache has done so far.
+     */
+    Stats stats() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return Stats{hits, misses, bytesRead, ioSeconds, cachedBytes, capacity};
+    }
+
+    /**
+     * ColumnCache::encode
+     * -------------------
+     * Appends the column of a matrix with numRows answers to the words, stored the way it is in memory.
+     */
+    static void encode(const HybridColumn& column, int numRows, std::vector<uint64_t>& words) {
+        if(column.isDense()) {
+            size_t first = words.size();
+            words.push_back(1);
+            words.push_back(BitVector::wordsFor(numRows));
+            words.resize(first + 2 + BitVector::wordsFor(numRows), 0);
+            column.forEachWord([&words, first](int word, uint64_t bits) { words[first + 2 + word] = bits; });
+        } else {
+            size_t first = words.size();
+            words.push_back(0);
+            words.push_back(column.count());
+            words.resize(first + 2 + (column.count() + 1) / 2, 0);
+            uint32_t* rows = reinterpret_cast<uint32_t*>(words.data() + first + 2);
+            int next = 0;
+            column.forEachSet([rows, &next](int row) { rows[next++] = row; });
+        }
+    }
+
+    /**
+     * ColumnCache::encodedWords
+     * -------------------------
+     * Returns the number of words a column takes, from the two words it starts with.
+     */
+    static uint64_t encodedWords(uint64_t kind, uint64_t count) {
+        return 2 + ((kind == 1)? count: (count + 1) / 2);
+    }
+
+    /**
+     * ColumnCache::decode
+     * -------------------
+     * Returns the column of a matrix with numRows answers that starts at the words, which must have been checked
+     * to be a valid column.
+     */
+    static std::shared_ptr<HybridColumn> decode(const uint64_t* words, int numRows) {
+        std::shared_ptr<HybridColumn> column = std::make_shared<HybridColumn>();
+        if(words[0] == 1) column->assign(words + 2, numRows);
+        else column->assign(reinterpret_cast<const uint32_t*>(words + 2), words[1], numRows);
+        return column;
+    }
+
+private:
+    struct Entry {
+        uint64_t offset;
+        std::shared_ptr<const HybridColumn> column;
+    };
+
+    mutable std::mutex lock; // held while the cache or the file is used
+    FILE* file;
+    std::string filename; // empty for a temporary file
+    uint64_t fileEnd; // where the next spilled column goes
+    size_t capacity;
+    size_t cachedBytes;
+    std::list<Entry> recent; // the columns in memory, most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> entries; // offset to its place in recent
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t bytesRead;
+    double ioSeconds;
+
+    /* Reads and unpacks the column at the offset.  Throws an error if it cannot be read. */
+    std::shared_ptr<const HybridColumn> read(uint64_t offset, int numRows) {
+        INSTRUMENT_TIMER("column_cache_read");
+        std::vector<uint64_t> words(2);
+        if(fseek(file, long(offset), SEEK_SET) != 0 || fread(words.data(), sizeof(uint64_t), 2, file) != 2)
+            error("Could not read the column file");
+        uint64_t kind = words[0], count = words[1];
+        if(kind > 1 || (kind == 1 && count != uint64_t(BitVector::wordsFor(numRows))) || (kind == 0 && count > uint64_t(numRows)))
+            error("Column file is invalid");
+        words.resize(encodedWords(kind, count));
+        if(fread(words.data() + 2, sizeof(uint64_t), words.size() - 2, file) != words.size() - 2)
+            error("Column file is truncated");
+        bytesRead += words.size() * sizeof(uint64_t);
+        return decode(words.data(), numRows);
+    }
+};
+
+#endif
@@ -0,0 +1,127 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * DecisionTree
+ * --------------
+ * This class holds the questions that a session would ask in the opening moves of every game,
+ * worked out ahead of time.  The first few questions of every game see the same candidates, so
+ * the session's answer to "what next?" only depends on the responses so far, and can be looked
+ * up instead of searched for.  The tree is complete up to its depth and stored as a flat array
+ * in heap order: the root is node 0, and the children of node n are 2n + 1 (the user said yes)
+ * and 2n + 2 (the user said no).  Each node holds the index of its question, or -1 where the
+ * session would guess instead (or has run out of candidates), which ends that branch.
+ * A tree only describes sessions that pick questions with the rules it was planned with, so it
+ * remembers the strategy, noise rate and maximum number of mismatches.  Sessions also avoid questions
+ * whose columns are on disk, so it remembers a fingerprint of which columns were offloaded too (see
+ * QuestionsDatabase::offloadedFingerprint), which is 0 when every column was in memory.
+ */
+
+#ifndef _decisiontree_
+#define _decisiontree_
+
+#include <cstdint>
+#include <vector>
+#include "error.h"
+
+class DecisionTree {
+
+public:
+
+    /* The deepest tree that can be planned; that is about a million nodes. */
+    static const int maxDepth = 20;
+
+    /**
+     * DecisionTree::DecisionTree
+     * --------------------------
+     * Creates an empty tree, which never has a question to ask.
+     */
+    DecisionTree() : depth(0), strategy(0), noiseRate(0.0), maxMismatches(0), offloaded(0) {}
+
+    /**
+     * DecisionTree::DecisionTree
+     * --------------------------
+     * Creates a tree of the given depth for sessions that play by the given rules against a database with the
+     * given columns offloaded, where no node has a question yet.
+     */
+    DecisionTree(int depth, int strategy, double noiseRate, int maxMismatches, uint64_t offloaded) :
+        depth(depth), strategy(strategy), noiseRate(noiseRate), maxMismatches(maxMismatches), offloaded(offloaded) {
+        if(depth < 0 || depth > maxDepth) error("Decision tree depth is out of range");
+        nodes.assign((size_t(1) << depth) - 1, -1);
+    }
+
+    /**
+     * DecisionTree::isEmpty
+     * ---------------------
+     * Returns whether the tree has no nodes at all.
+     */
+    bool isEmpty() const {
+        return nodes.empty();
+    }
+
+    /**
+     * DecisionTree::plannedFor
+     * ------------------------
+     * Returns whether the tree was planned with these rules and these columns offloaded, and so can be followed by a
+     * session that plays by them.
+     */
+    bool plannedFor(int strategy, double noiseRate, int maxMismatches, uint64_t offloaded) const {
+        return !isEmpty() && this->strategy == strategy && this->noiseRate == noiseRate &&
+               this->maxMismatches == maxMismatches && this->offloaded == offloaded;
+    }
+
+    /**
+     * DecisionTree::question
+     * ----------------------
+     * Returns the index of the question to ask at the node, or -1 if the tree does not know what to do there.
+     */
+    int question(int node) const {
+        return nodes[node];
+    }
+
+    /**
+     * DecisionTree::setQuestion
+     * -------------------------
+     * Sets the question to ask at the node.
+     */
+    void setQuestion(int node, int question) {
+        nodes[node] = question;
+    }
+
+    /**
+     * DecisionTree::child
+     * -------------------
+     * Returns the node reached from the node by the response, or -1 if that is past the bottom of the tree.
+     */
+    int child(int node, bool response) const {
+        size_t next = 2 * size_t(node) + (response? 1: 2);
+        return (next < nodes.size())? int(next): -1;
+    }
+
+    /**
+     * DecisionTree::numNodes
+     * ----------------------
+     * Returns the number of nodes in the tree, including the ones without a question.
+     */
+    int numNodes() const {
+        return nodes.size();
+    }
+
+    /* Accessors for the rules the tree was planned with, and its raw nodes, so that it can be saved. */
+    int getDepth() const { return depth; }
+    int getStrategy() const { return strategy; }
+    double getNoiseRate() const { return noiseRate; }
+    int getMaxMismatches() const { return maxMismatches; }
+    uint64_t getOffloaded() const { return offloaded; }
+    const int32_t* data() const { return nodes.data(); }
+    int32_t* data() { return nodes.data(); }
+
+private:
+    int depth;
+    int strategy;
+    double noiseRate;
+    int maxMismatches;
+    uint64_t offloaded; // the fingerprint of the columns that were on disk, or 0 if none were
+    std::vector<int32_t> nodes; // node to the index of its question, or -1
+};
+
+#endif
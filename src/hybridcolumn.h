@@ -0,0 +1,253 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * HybridColumn
+ * --------------
+ * This class is one question's column of the incidence matrix: the set of answers that fit the
+ * question.  Most questions only fit a handful of answers while a few fit a large share of them, so
+ * a column is stored in whichever of two ways is smaller, in the spirit of roaring bitmaps.  A sparse
+ * column is a sorted array of answer indices, four bytes per answer that fits.  Once that array would
+ * take more room than one bit per answer, the column turns into a BitVector instead.  Either way the
+ * column has no length of its own: answers past its last set bit simply do not fit the question.
+ */
+
+#ifndef _hybridcolumn_
+#define _hybridcolumn_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "bitvector.h"
+
+class HybridColumn {
+
+public:
+
+    /**
+     * HybridColumn::HybridColumn
+     * --------------------------
+     * Creates an empty column, stored as an array.
+     */
+    HybridColumn() : dense(false) {
+    }
+
+    /**
+     * HybridColumn::isDense
+     * ---------------------
+     * Returns whether the column is stored as a bit per answer rather than as an array of answers.
+     */
+    bool isDense() const {
+        return dense;
+    }
+
+    /**
+     * HybridColumn::denseBits
+     * -----------------------
+     * Returns the bits of a dense column, which may be shorter than the matrix.  Only valid when isDense().
+     */
+    const BitVector& denseBits() const {
+        return bits;
+    }
+
+    /**
+     * HybridColumn::test
+     * ------------------
+     * Returns whether or not the answer is in the column.  For an array this is a binary search.
+     */
+    bool test(int row) const {
+        if(dense) return row < bits.size() && bits.test(row);
+        return std::binary_search(rows.begin(), rows.end(), uint32_t(row));
+    }
+
+    /**
+     * HybridColumn::set
+     * -----------------
+     * Adds the answer to a column of a matrix with numRows answers.  Adding answers in increasing order (as a
+     * loader or an append does) only ever appends to the array.  If the array grows past the size of a bit per
+     * answer, the column becomes dense.
+     */
+    void set(int row, int numRows) {
+        if(dense) {
+            if(bits.size() <= row) bits.resize(numRows);
+            bits.set(row);
+            return;
+        }
+        if(rows.empty() || rows.back() < uint32_t(row)) {
+            rows.push_back(row);
+        } else {
+            std::vector<uint32_t>::iterator position = std::lower_bound(rows.begin(), rows.end(), uint32_t(row));
+            if(*position == uint32_t(row)) return;
+            rows.insert(position, row);
+        }
+        if(rows.size() * bitsPerRow > size_t(numRows)) makeDense(numRows);
+    }
+
+    /**
+     * HybridColumn::assign
+     * --------------------
+     * Replaces the column with the numRows bits packed in the words (laid out like BitVector::data), stored in
+     * whichever way is smaller.
+     */
+    void assign(const uint64_t* packed, int numRows) {
+        BitVector loaded;
+        loaded.assign(packed, numRows);
+        rows.clear();
+        dense = false;
+        bits = BitVector();
+        if(size_t(loaded.count()) * bitsPerRow > size_t(numRows)) {
+            bits = loaded;
+            dense = true;
+        } else {
+            loaded.forEachSet([this](int row) { rows.push_back(row); });
+        }
+    }
+
+    /**
+     * HybridColumn::assign
+     * --------------------
+     * Replaces the column with the given answers of a matrix with numRows answers, which must be in increasing
+     * order and less than numRows, stored in whichever way is smaller.
+     */
+    void assign(const uint32_t* sorted, int count, int numRows) {
+        rows.assign(sorted, sorted + count);
+        dense = false;
+        bits = BitVector();
+        if(rows.size() * bitsPerRow > size_t(numRows)) makeDense(numRows);
+    }
+
+    /**
+     * HybridColumn::truncate
+     * ----------------------
+     * Removes every answer from numRows on.
+     */
+    void truncate(int numRows) {
+        if(dense) {
+            if(bits.size() > numRows) bits.resize(numRows);
+        } else {
+            rows.erase(std::lower_bound(rows.begin(), rows.end(), uint32_t(numRows)), rows.end());
+        }
+    }
+
+    /**
+     * HybridColumn::count
+     * -------------------
+     * Returns the number of answers in the column.
+     */
+    int count() const {
+        return dense? bits.count(): rows.size();
+    }
+
+    /**
+     * HybridColumn::andCount
+     * ----------------------
+     * Returns how many answers are both in the column and set in the vector (such as the candidates that are
+     * left).  An array tests the vector's bit for each of its answers; a dense column is an and / popcount.
+     */
+    int andCount(const BitVector& other) const {
+        if(dense) return bits.andCount(other);
+        int total = 0;
+        for(uint32_t row: rows) {
+            if(int(row) >= other.size()) break;
+            total += other.test(row);
+        }
+        return total;
+    }
+
+    /**
+     * HybridColumn::forEachSet
+     * ------------------------
+     * Calls the function with every answer in the column, in increasing order.
+     */
+    template <typename Function>
+    void forEachSet(Function function) const {
+        if(dense) {
+            bits.forEachSet(function);
+        } else {
+            for(uint32_t row: rows)
+                function(int(row));
+        }
+    }
+
+    /**
+     * HybridColumn::forEachWord
+     * -------------------------
+     * Calls function(word, bits) for every 64 answer word that holds an answer of the column, in increasing
+     * order, with the answers of that word packed the same way as in a BitVector.
+     */
+    template <typename Function>
+    void forEachWord(Function function) const {
+        if(dense) {
+            const uint64_t* words = bits.data();
+            for(int word = 0; word < bits.numWords(); word++) {
+                if(words[word] != 0) function(word, words[word]);
+            }
+            return;
+        }
+        size_t next = 0;
+        while(next < rows.size()) {
+            int word = rows[next] / 64;
+            uint64_t packed = 0;
+            for(; next < rows.size() && int(rows[next] / 64) == word; next++)
+                packed |= uint64_t(1) << (rows[next] % 64);
+            function(word, packed);
+        }
+    }
+
+    /**
+     * HybridColumn::equals
+     * --------------------
+     * Returns whether both columns hold the same answers, however each of them is stored.
+     */
+    bool equals(const HybridColumn& other) const {
+        if(!dense && !other.dense) return rows == other.rows;
+        if(dense && other.dense) return count() == other.count() && bits.andCount(other.bits) == count();
+        const HybridColumn& sparse = dense? other: *this;
+        const HybridColumn& packed = dense? *this: other;
+        if(sparse.count() != packed.count()) return false;
+        for(uint32_t row: sparse.rows) {
+            if(!packed.test(row)) return false;
+        }
+        return true;
+    }
+
+    /**
+     * HybridColumn::hash
+     * ------------------
+     * Returns a hash of the answers in the column that does not depend on how it is stored, so that equal
+     * columns can be found without comparing every pair.
+     */
+    uint64_t hash() const {
+        uint64_t hash = 14695981039346656037ull;
+        forEachSet([&hash](int row) { hash = (hash ^ uint64_t(row)) * 1099511628211ull; });
+        return hash;
+    }
+
+    /**
+     * HybridColumn::memoryUsage
+     * -------------------------
+     * Returns roughly how many bytes the column takes, including the object itself.
+     */
+    size_t memoryUsage() const {
+        return sizeof(HybridColumn) + rows.capacity() * sizeof(uint32_t) + bits.numWords() * sizeof(uint64_t);
+    }
+
+private:
+    /* An array entry takes 32 bits, so an array is kept while it is no bigger than a bit per answer. */
+    static const int bitsPerRow = 32;
+
+    bool dense; // whether the answers are stored in bits rather than rows
+    std::vector<uint32_t> rows; // the answers in increasing order, while the column is sparse
+    BitVector bits; // bit per answer, once the column is dense
+
+    /* Moves the answers from the array into a vector of numRows bits. */
+    void makeDense(int numRows) {
+        bits = BitVector(numRows);
+        for(uint32_t row: rows)
+            bits.set(row);
+        rows.clear();
+        rows.shrink_to_fit();
+        dense = true;
+    }
+};
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * Instrument
+ * --------------
+ * These macros count what the hot paths of the program do and how long they take, so that a slow game
+ * can be traced to the phase that is slow.  They cost nothing unless the program is compiled with
+ * TWENTY_QUESTIONS_INSTRUMENT defined, in which case:
+ *
+ *     INSTRUMENT_COUNT("name", amount)   adds one event of the given amount to the counter
+ *     INSTRUMENT_TIMER("name")           adds the nanoseconds until the end of the scope to "name_ns"
+ *
+ * Every counter keeps the number of events and the sum of their amounts, so a timer gives the number of
+ * calls and the total time, and a count such as the number of candidates scanned gives how many scans
+ * there were and how many candidates they covered in total.  Counters are shared by every thread and
+ * every session, and live until the program ends.  Instrument::writeText writes them in the Prometheus
+ * text format, one "_count" and one "_sum" line per counter.
+ */
+
+#ifndef _instrument_
+#define _instrument_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Instrument {
+
+public:
+
+    /* One named counter.  Adding to it is a pair of relaxed atomic additions. */
+    struct Counter {
+        std::string name;
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+
+        Counter(const std::string& name) : name(name), count(0), sum(0) {}
+
+        void add(uint64_t amount) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            sum.fetch_add(amount, std::memory_order_relaxed);
+        }
+    };
+
+    /* Adds the time from its creation to its destruction to a counter. */
+    class ScopedTimer {
+    public:
+        ScopedTimer(Counter& counter) : counter(counter), start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            counter.add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start).count());
+        }
+    private:
+        Counter& counter;
+        std::chrono::steady_clock::time_point start;
+    };
+
+#ifdef TWENTY_QUESTIONS_INSTRUMENT
+    static const bool enabled = true;
+#else
+    static const bool enabled = false;
+#endif
+
+    /**
+     * Instrument::counter
+     * -------------------
+     * Returns the counter with the name, creating it the first time.  The macros look each counter up once
+     * and keep the reference, so this is not on any hot path.
+     */
+    static Counter& counter(const std::string& name) {
+        std::lock_guard<std::mutex> lock(registry().lock);
+        for(Counter& counter: registry().counters) {
+            if(counter.name == name) return counter;
+        }
+        registry().counters.emplace_back(name);
+        return registry().counters.back();
+    }
+
+    /**
+     * Instrument::forEach
+     * -------------------
+     * Calls the function with the name, number of events and sum of every counter, in name order.
+     */
+    template <typename Function>
+    static void forEach(Function function) {
+        std::vector<const Counter*> sorted;
+        {
+            std::lock_guard<std::mutex> lock(registry().lock);
+            for(const Counter& counter: registry().counters)
+                sorted.push_back(&counter);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const Counter* a, const Counter* b) { return a->name < b->name; });
+        for(const Counter* counter: sorted)
+            function(counter->name, counter->count.load(), counter->sum.load());
+    }
+
+    /**
+     * Instrument::writeText
+     * ---------------------
+     * Writes every counter in the Prometheus text format, so that a dump can be scraped or compared with diff.
+     */
+    static void writeText(std::ostream& out) {
+        forEach([&out](const std::string& name, uint64_t count, uint64_t sum) {
+            out << "twenty_questions_" << name << "_count " << count << "\n";
+            out << "twenty_questions_" << name << "_sum " << sum << "\n";
+        });
+        out.flush();
+    }
+
+private:
+    struct Registry {
+        std::mutex lock;
+        std::deque<Counter> counters; // a deque so that handing out references stays safe as it grows
+    };
+
+    static Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+};
+
+#define INSTRUMENT_JOIN_(a, b) a##b
+#define INSTRUMENT_JOIN(a, b) INSTRUMENT_JOIN_(a, b)
+
+#ifdef TWENTY_QUESTIONS_INSTRUMENT
+#define INSTRUMENT_COUNT(name, amount) \
+    do { \
+        static Instrument::Counter& instrumentCounter = Instrument::counter(name); \
+        instrumentCounter.add(amount); \
+    } while(0)
+#define INSTRUMENT_TIMER(name) \
+    static Instrument::Counter& INSTRUMENT_JOIN(instrumentTimerCounter, __LINE__) = Instrument::counter(name "_ns"); \
+    Instrument::ScopedTimer INSTRUMENT_JOIN(instrumentTimer, __LINE__)(INSTRUMENT_JOIN(instrumentTimerCounter, __LINE__))
+#else
+#define INSTRUMENT_COUNT(name, amount) ((void)0)
+#define INSTRUMENT_TIMER(name) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * InternTable
+ * --------------
+ * This class stores every unique name exactly once and hands out a dense 32 bit id for it, so
+ * that the rest of the program can pass ids around instead of strings.  The characters of all of
+ * the names live back to back in one arena, and the hash table used to find a name only holds ids,
+ * so a name costs its characters plus a few bytes of bookkeeping rather than a std::string (and a
+ * second copy as a hash map key).  Names are handed out as string_views into the arena; they stay
+ * valid until the next name is interned.
+ */
+
+#ifndef _interntable_
+#define _interntable_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+class InternTable {
+
+public:
+
+    /**
+     * InternTable::InternTable
+     * ------------------------
+     * Creates an empty table.
+     */
+    InternTable() : slots(minSlots, -1) {
+        offsets.push_back(0);
+    }
+
+    /**
+     * InternTable::reserve
+     * --------------------
+     * Makes room for the given number of names and characters, so that loading a known number of
+     * names does not have to grow the arena or the hash table along the way.
+     */
+    void reserve(int numNames, size_t numChars) {
+        arena.reserve(numChars);
+        offsets.reserve(numNames + 1);
+        hashes.reserve(numNames);
+        if(size_t(numNames) * 2 > slots.size()) rehash(slotsFor(numNames));
+    }
+
+    /**
+     * InternTable::intern
+     * -------------------
+     * Returns the id of the name, giving it the next id if it has not been seen before.
+     */
+    int intern(std::string_view name) {
+        uint32_t hash = hashOf(name);
+        size_t slot = findSlot(name, hash);
+        if(slots[slot] != -1) return slots[slot];
+        int id = hashes.size();
+        arena.insert(arena.end(), name.begin(), name.end());
+        offsets.push_back(arena.size());
+        hashes.push_back(hash);
+        slots[slot] = id;
+        if(hashes.size() * 2 > slots.size()) rehash(slots.size() * 2);
+        return id;
+    }
+
+    /**
+     * InternTable::find
+     * -----------------
+     * Returns the id of the name, or -1 if it has never been interned.
+     */
+    int find(std::string_view name) const {
+        return slots[findSlot(name, hashOf(name))];
+    }
+
+    /**
+     * InternTable::name
+     * -----------------
+     * Returns the name with the given id.
+     */
+    std::string_view name(int id) const {
+        return std::string_view(arena.data() + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+
+    /**
+     * InternTable::size
+     * -----------------
+     * Returns the number of unique names.
+     */
+    int size() const {
+        return hashes.size();
+    }
+
+    /**
+     * InternTable::memoryUsage
+     * ------------------------
+     * Returns the number of bytes the table has allocated.
+     */
+    size_t memoryUsage() const {
+        return arena.capacity() + offsets.capacity() * sizeof(uint64_t) + hashes.capacity() * sizeof(uint32_t) +
+               slots.capacity() * sizeof(int32_t);
+    }
+
+private:
+    static const size_t minSlots = 16;
+
+    std::vector<char> arena; // the characters of every name, back to back
+    std::vector<uint64_t> offsets; // id to the start of its name in the arena (plus the end of the last name)
+    std::vector<uint32_t> hashes; // id to the hash of its name, so that growing never rehashes strings
+    std::vector<int32_t> slots; // open addressing table of ids, -1 for an empty slot
+
+    static uint32_t hashOf(std::string_view name) {
+        uint32_t hash = 2166136261u;
+        for(char c: name)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+        return hash;
+    }
+
+    static size_t slotsFor(int numNames) {
+        size_t numSlots = minSlots;
+        while(numSlots < size_t(numNames) * 2) numSlots *= 2;
+        return numSlots;
+    }
+
+    /* Returns the slot holding the name, or the empty slot where it would go. */
+    size_t findSlot(std::string_view name, uint32_t hash) const {
+        size_t mask = slots.size() - 1;
+        for(size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+            int id = slots[slot];
+            if(id == -1 || (hashes[id] == hash && this->name(id) == name)) return slot;
+        }
+    }
+
+    void rehash(size_t numSlots) {
+        slots.assign(numSlots, -1);
+        size_t mask = numSlots - 1;
+        for(int id = 0; id < int(hashes.size()); id++) {
+            size_t slot = hashes[id] & mask;
+            while(slots[slot] != -1) slot = (slot + 1) & mask;
+            slots[slot] = id;
+        }
+    }
+};
+
+#endif
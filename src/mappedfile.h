@@ -0,0 +1,132 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * MappedFile
+ * --------------
+ * This class maps a whole file into memory so that it can be read like an array without
+ * copying it.  The mapping can be made private and writable, in which case changes are only
+ * seen by this process (the pages are copied the first time they are written) and the file on
+ * disk is never modified.  On platforms without mmap the file is read into a single buffer.
+ */
+
+#ifndef _mappedfile_
+#define _mappedfile_
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile {
+
+public:
+
+    /**
+     * MappedFile::MappedFile
+     * ----------------------
+     * Creates an object that does not have a file mapped yet.
+     */
+    MappedFile() : bytes(NULL), length(0), mapped(false) {}
+
+    /**
+     * MappedFile::~MappedFile
+     * -----------------------
+     * Unmaps the file.  Pointers into the file are no longer valid afterwards.
+     */
+    ~MappedFile() {
+        close();
+    }
+
+    /**
+     * MappedFile::open
+     * ----------------
+     * Maps the file into memory, read only or as a private writable copy.  Returns false if the file
+     * could not be opened.  A hint can be passed on to the kernel about whether the file will be read
+     * from front to back.
+     */
+    bool open(const std::string& filename, bool writable, bool sequential = true) {
+        close();
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if(fd < 0) return false;
+        struct stat info;
+        if(fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+        length = info.st_size;
+        if(length > 0) {
+            void* mapping = mmap(NULL, length, writable? PROT_READ | PROT_WRITE: PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping == MAP_FAILED) {
+                ::close(fd);
+                length = 0;
+                return false;
+            }
+            madvise(mapping, length, sequential? MADV_SEQUENTIAL: MADV_RANDOM);
+            bytes = static_cast<char*>(mapping);
+            mapped = true;
+        }
+        ::close(fd);
+        return true;
+#else
+        (void) writable;
+        (void) sequential;
+        std::ifstream input(filename, std::ios::binary);
+        if(input.fail()) return false;
+        input.seekg(0, std::ios::end);
+        length = input.tellg();
+        input.seekg(0, std::ios::beg);
+        bytes = new char[length];
+        input.read(bytes, length);
+        return true;
+#endif
+    }
+
+    /**
+     * MappedFile::close
+     * -----------------
+     * Releases the mapping (or the buffer the file was read into).
+     */
+    void close() {
+#ifndef _WIN32
+        if(mapped && bytes != NULL) munmap(bytes, length);
+#endif
+        if(!mapped) delete[] bytes;
+        bytes = NULL;
+        length = 0;
+        mapped = false;
+    }
+
+    /**
+     * MappedFile::data
+     * ----------------
+     * Returns the first byte of the file.  Only write through it if the file was opened writable.
+     */
+    char* data() const {
+        return bytes;
+    }
+
+    /**
+     * MappedFile::size
+     * ----------------
+     * Returns the number of bytes in the file.
+     */
+    size_t size() const {
+        return length;
+    }
+
+private:
+    char* bytes;
+    size_t length;
+    bool mapped;
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+#endif
@@ -0,0 +1,207 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * SessionLog
+ * --------------
+ * This class records everything a session has been told, so that the game can be saved and picked up
+ * again later or on another host.  A session's state only depends on the rules it plays by, the
+ * database, and the responses it was given in order, so the log holds just those: the strategy, noise
+ * rate and maximum number of mismatches, the size and fingerprint of the database it was played against
+ * (see QuestionsDatabase::fingerprint), and one event for every response, which is either the index of a
+ * question with the user's yes or no and the number of the turn it was asked on, or the index of an answer
+ * whose guess was rejected.
+ * encode() packs the log into a few bytes (32 for the rules, and 6 for every event, in the machine's
+ * byte order like a snapshot) and decode() unpacks them again.  See Session::Session for how a session
+ * is restored from a log.
+ */
+
+#ifndef _sessionlog_
+#define _sessionlog_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "error.h"
+
+class SessionLog {
+
+public:
+
+    /* What one event records. */
+    enum EventKind {
+        ANSWERED_NO = 0,
+        ANSWERED_YES = 1,
+        REJECTED_GUESS = 2
+    };
+
+    struct Event {
+        int32_t index; // the question, or the answer that was guessed
+        uint8_t kind;
+        uint8_t turn; // the number of the question the response was given on
+    };
+
+    /**
+     * SessionLog::SessionLog
+     * ----------------------
+     * Creates an empty log with no rules, which is only good for decoding into.
+     */
+    SessionLog() : strategy(0), noiseRate(0.0), maxMismatches(0), numAnswers(0), numQuestions(0), database(0) {}
+
+    /**
+     * SessionLog::SessionLog
+     * ----------------------
+     * Creates an empty log for a session that plays by the given rules against a database of the given size and
+     * fingerprint.
+     */
+    SessionLog(int strategy, double noiseRate, int maxMismatches, int numAnswers, int numQuestions,
+               uint64_t database) :
+        strategy(strategy), noiseRate(noiseRate), maxMismatches(maxMismatches), numAnswers(numAnswers),
+        numQuestions(numQuestions), database(database) {
+        if(maxMismatches > UINT8_MAX) error("Too many mismatches to log");
+    }
+
+    /**
+     * SessionLog::addResponse
+     * -----------------------
+     * Records the response to the question, which was asked on the given turn.
+     */
+    void addResponse(int question, bool response, int turn) {
+        events.push_back(Event{question, uint8_t(response? ANSWERED_YES: ANSWERED_NO), uint8_t(turn)});
+    }
+
+    /**
+     * SessionLog::addRejectedGuess
+     * ----------------------------
+     * Records that the answer was guessed and was wrong.  A session is not told which turn a guess was made on,
+     * but every guess takes a turn of its own, so it is taken to be the turn after the last event.
+     */
+    void addRejectedGuess(int answer) {
+        events.push_back(Event{answer, uint8_t(REJECTED_GUESS), uint8_t(lastTurn() + 1)});
+    }
+
+    /**
+     * SessionLog::lastTurn
+     * --------------------
+     * Returns the turn of the last event, or 0 if nothing has happened yet.
+     */
+    int lastTurn() const {
+        return events.empty()? 0: events.back().turn;
+    }
+
+    /**
+     * SessionLog::encode
+     * ------------------
+     * Returns the log packed into bytes.
+     */
+    std::string encode() const {
+        std::string bytes(headerBytes + events.size() * eventBytes, '\0');
+        char* next = &bytes[0];
+        memcpy(next, magic, 4);
+        put(next + 4, uint8_t(strategy));
+        put(next + 5, uint8_t(maxMismatches));
+        put(next + 6, uint16_t(events.size()));
+        put(next + 8, noiseRate);
+        put(next + 16, uint32_t(numAnswers));
+        put(next + 20, uint32_t(numQuestions));
+        put(next + 24, database);
+        next += headerBytes;
+        for(const Event& event: events) {
+            put(next, event.index);
+            put(next + 4, event.kind);
+            put(next + 5, event.turn);
+            next += eventBytes;
+        }
+        return bytes;
+    }
+
+    /**
+     * SessionLog::decode
+     * ------------------
+     * Replaces the log with the one packed into the bytes by encode().  Returns false, leaving the log as it was, if
+     * the bytes are not a log, including one whose rules no session plays by (there are two strategies, and the
+     * noise rate is between 0 and 0.5).  See fits() for checking the events against a database.
+     */
+    bool decode(const std::string& bytes) {
+        if(bytes.size() < headerBytes || memcmp(bytes.data(), magic, 4) != 0) return false;
+        const char* next = bytes.data();
+        uint16_t numEvents = get<uint16_t>(next + 6);
+        if(bytes.size() != headerBytes + numEvents * eventBytes) return false;
+        double decodedNoise = get<double>(next + 8);
+        if(get<uint8_t>(next + 4) > 1 || !(decodedNoise > 0.0 && decodedNoise < 0.5)) return false;
+        std::vector<Event> decoded(numEvents);
+        for(int event = 0; event < numEvents; event++) {
+            const char* packed = next + headerBytes + event * eventBytes;
+            decoded[event] = Event{get<int32_t>(packed), get<uint8_t>(packed + 4), get<uint8_t>(packed + 5)};
+            if(decoded[event].kind > REJECTED_GUESS || decoded[event].index < 0) return false;
+        }
+        strategy = get<uint8_t>(next + 4);
+        maxMismatches = get<uint8_t>(next + 5);
+        noiseRate = decodedNoise;
+        numAnswers = get<uint32_t>(next + 16);
+        numQuestions = get<uint32_t>(next + 20);
+        database = get<uint64_t>(next + 24);
+        events.swap(decoded);
+        return true;
+    }
+
+    /**
+     * SessionLog::fits
+     * ----------------
+     * Returns whether the log was recorded against a database of the given size and fingerprint, and every question
+     * and answer in it is in that database.
+     */
+    bool fits(int numAnswers, int numQuestions, uint64_t database) const {
+        if(numAnswers != this->numAnswers || numQuestions != this->numQuestions || database != this->database)
+            return false;
+        for(const Event& event: events) {
+            if(event.index >= ((event.kind == REJECTED_GUESS)? numAnswers: numQuestions)) return false;
+        }
+        return true;
+    }
+
+    /* Accessors for the rules the session played by, the database it was played against, and its events. */
+    int getStrategy() const { return strategy; }
+    double getNoiseRate() const { return noiseRate; }
+    int getMaxMismatches() const { return maxMismatches; }
+    int getNumAnswers() const { return numAnswers; }
+    int getNumQuestions() const { return numQuestions; }
+    uint64_t getDatabase() const { return database; }
+    const std::vector<Event>& getEvents() const { return events; }
+
+    /**
+     * SessionLog::memoryUsage
+     * -----------------------
+     * Returns roughly how many bytes the events take.
+     */
+    size_t memoryUsage() const {
+        return events.capacity() * sizeof(Event);
+    }
+
+private:
+    static const size_t headerBytes = 32;
+    static const size_t eventBytes = 6;
+    static constexpr const char* magic = "TQL2";
+
+    int strategy;
+    double noiseRate;
+    int maxMismatches;
+    int numAnswers;
+    int numQuestions;
+    uint64_t database; // the fingerprint of the database
+    std::vector<Event> events; // in the order they happened
+
+    template <typename T>
+    static void put(char* bytes, T value) {
+        memcpy(bytes, &value, sizeof(T));
+    }
+
+    template <typename T>
+    static T get(const char* bytes) {
+        T value;
+        memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+};
+
+#endif
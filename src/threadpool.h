@@ -0,0 +1,121 @@
+/**
+ * Name: Max Pike
+ * --------------
+ * ThreadPool
+ * --------------
+ * This class keeps a fixed number of worker threads alive so that work which can be split
+ * into independent ranges (such as scanning every question for the best split) can be spread
+ * across all of the cores without creating new threads each turn.  Any number of threads may
+ * call parallelFor at the same time; each call waits only on its own ranges.
+ */
+
+#ifndef _threadpool_
+#define _threadpool_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+
+public:
+
+    /**
+     * ThreadPool::ThreadPool
+     * ----------------------
+     * Starts the given number of worker threads, which sleep until work is handed to them.
+     */
+    explicit ThreadPool(int numThreads) : stopping(false) {
+        for(int i = 0; i < numThreads; i++)
+            workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+    }
+
+    /**
+     * ThreadPool::~ThreadPool
+     * -----------------------
+     * Lets the workers finish the work that is already queued and then joins them.
+     */
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for(std::thread& worker: workers)
+            worker.join();
+    }
+
+    /**
+     * ThreadPool::size
+     * ----------------
+     * Returns the number of worker threads.
+     */
+    int size() const {
+        return workers.size();
+    }
+
+    /**
+     * ThreadPool::parallelFor
+     * -----------------------
+     * Splits [begin, end) into at most size() + 1 contiguous chunks and calls body(chunk, chunkBegin, chunkEnd)
+     * for each of them.  Chunks are numbered in order, so a caller that keeps one result per chunk can
+     * combine them in the same order a serial loop would have seen them.  The calling thread runs the
+     * first chunk itself and returns once every chunk is done.  Returns the number of chunks used.
+     */
+    int parallelFor(int begin, int end, const std::function<void(int, int, int)>& body) {
+        int length = end - begin;
+        int numChunks = size() + 1;
+        if(numChunks > length) numChunks = length;
+        if(numChunks <= 1) {
+            if(length > 0) body(0, begin, end);
+            return length > 0 ? 1 : 0;
+        }
+        std::mutex doneLock;
+        std::condition_variable done;
+        int remaining = numChunks - 1;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            for(int chunk = 1; chunk < numChunks; chunk++) {
+                int chunkBegin = begin + int((long long)length * chunk / numChunks);
+                int chunkEnd = begin + int((long long)length * (chunk + 1) / numChunks);
+                tasks.push_back([&, chunk, chunkBegin, chunkEnd]() {
+                    body(chunk, chunkBegin, chunkEnd);
+                    std::lock_guard<std::mutex> doneGuard(doneLock);
+                    if(--remaining == 0) done.notify_one();
+                });
+            }
+        }
+        wakeUp.notify_all();
+        body(0, begin, begin + length / numChunks);
+        std::unique_lock<std::mutex> doneGuard(doneLock);
+        done.wait(doneGuard, [&]() { return remaining == 0; });
+        return numChunks;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > tasks;
+    std::mutex lock;
+    std::condition_variable wakeUp;
+    bool stopping;
+
+    /* Runs queued tasks until the pool is destroyed and the queue is empty. */
+    void workerLoop() {
+        while(true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wakeUp.wait(guard, [this]() { return stopping || !tasks.empty(); });
+                if(tasks.empty()) return;
+                task = tasks.front();
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+#endif